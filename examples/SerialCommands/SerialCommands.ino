@@ -1,6 +1,6 @@
 #include <CommandParser.h>
 
-typedef CommandParser<> MyCommandParser;
+typedef StreamingCommandParser<> MyCommandParser;
 
 MyCommandParser parser;
 
@@ -22,13 +22,6 @@ void setup() {
 }
 
 void loop() {
-  if (Serial.available()) {
-    char line[128];
-    size_t lineLength = Serial.readBytesUntil('\n', line, 127);
-    line[lineLength] = '\0';
-
-    char response[MyCommandParser::MAX_RESPONSE_SIZE];
-    parser.processCommand(line, response);
-    Serial.println(response);
-  }
+  // parses whatever bytes have arrived so far without waiting for the rest of the line, and prints each command's response (or error message) back to Serial
+  parser.poll(Serial);
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+/*
+  bench.h - Shared setup for the host-side benchmarks in this directory.
+
+  These build with a desktop compiler rather than the Arduino IDE (which ignores `extras/`), for example:
+
+      g++ -std=gnu++11 -O2 -I../../src chunk_bench.cpp -o chunk_bench && ./chunk_bench
+*/
+
+#ifndef __COMMAND_PARSER_BENCH_H__
+#define __COMMAND_PARSER_BENCH_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// glibc only has `strlcpy` from 2.38 on, while Arduino cores and the BSDs always have it
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+static inline size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copied);
+        dst[copied] = '\0';
+    }
+    return length;
+}
+#endif
+
+#include "CommandParser.h"
+
+// stands in for `Serial`, counting what would have been printed
+struct BenchSink {
+    size_t bytes = 0;
+    size_t write(const uint8_t *, size_t length) { bytes += length; return length; }
+    size_t write(uint8_t) { bytes ++; return 1; }
+    size_t println(const char *line) { size_t length = strlen(line) + 2; bytes += length; return length; }
+};
+
+inline double benchSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// keeps the compiler from optimizing away a result that is otherwise unused
+template<typename T> inline void benchKeep(const T &value) { asm volatile("" : : "g"(&value) : "memory"); }
+
+#endif
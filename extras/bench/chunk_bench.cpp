@@ -0,0 +1,81 @@
+/*
+  chunk_bench.cpp - Throughput of `CommandParser<...>::processChunk`, which finds line ends with `memchr`, against feeding the same input one byte at a time with `StreamingCommandParser<...>::feed`.
+
+      g++ -std=gnu++11 -O2 -I../../src chunk_bench.cpp -o chunk_bench && ./chunk_bench
+*/
+
+#include "bench.h"
+
+typedef StreamingCommandParser<> BenchParser;
+
+static size_t calls = 0;
+static void cmd_count(BenchParser::Argument *, char *response) { calls ++; response[0] = '\0'; }
+
+static const char *const LINES[] = {
+    "move 120 -45\n",
+    "say \"hello, world\"\n",
+    "set 0x1F 3.25\n",
+    "status\r\n",
+    "say plain_word_argument\n",
+};
+
+// fills `data` with whole command lines, repeating `LINES`, and returns how many bytes were used
+static size_t fillInput(char *data, size_t size) {
+    size_t used = 0;
+    for (size_t i = 0; ; i ++) {
+        const char *line = LINES[i % (sizeof(LINES) / sizeof(LINES[0]))];
+        size_t length = strlen(line);
+        if (used + length > size) { return used; }
+        memcpy(data + used, line, length);
+        used += length;
+    }
+}
+
+static void registerCommands(BenchParser &parser) {
+    parser.registerCommand("move", "ii", &cmd_count);
+    parser.registerCommand("say", "s", &cmd_count);
+    parser.registerCommand("set", "ud", &cmd_count);
+    parser.registerCommand("status", "", &cmd_count);
+}
+
+static void benchChunkSize(size_t chunkSize, size_t totalBytes) {
+    static char input[64 * 1024], chunk[64 * 1024];
+    size_t inputLength = fillInput(input, chunkSize);
+    size_t rounds = totalBytes / inputLength;
+    BenchSink sink;
+
+    BenchParser chunked;
+    registerCommands(chunked);
+    CommandLineBuffer<128> partial;
+    calls = 0;
+    double start = benchSeconds();
+    for (size_t round = 0; round < rounds; round ++) {
+        memcpy(chunk, input, inputLength); // `processChunk` parses in place, so each round gets a fresh copy, as from a socket read
+        chunked.processChunk(chunk, inputLength, partial, sink);
+    }
+    double chunkedSeconds = benchSeconds() - start;
+    size_t chunkedCalls = calls;
+
+    BenchParser streamed;
+    registerCommands(streamed);
+    char response[BenchParser::MAX_RESPONSE_SIZE];
+    calls = 0;
+    start = benchSeconds();
+    for (size_t round = 0; round < rounds; round ++) {
+        memcpy(chunk, input, inputLength); // copied as well, so both loops pay for it
+        for (size_t i = 0; i < inputLength; i ++) { streamed.feed(chunk[i], response); }
+    }
+    double streamedSeconds = benchSeconds() - start;
+    benchKeep(sink.bytes);
+
+    double megabytes = (double)rounds * inputLength / (1024 * 1024);
+    printf("%6zu-byte chunks: processChunk %8.1f MB/s, feed %8.1f MB/s (%zu and %zu commands)\n", chunkSize, megabytes / chunkedSeconds, megabytes / streamedSeconds, chunkedCalls, calls);
+}
+
+int main() {
+    const size_t CHUNK_SIZES[] = {4 * 1024, 16 * 1024, 64 * 1024};
+    for (size_t i = 0; i < sizeof(CHUNK_SIZES) / sizeof(CHUNK_SIZES[0]); i ++) {
+        benchChunkSize(CHUNK_SIZES[i], 64 * 1024 * 1024);
+    }
+    return 0;
+}
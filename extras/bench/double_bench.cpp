@@ -0,0 +1,74 @@
+/*
+  double_bench.cpp - Speed of `strToDouble`, which `'d'` arguments are parsed with, against the C library's `strtod`, and a check that both give bit-identical results.
+
+      g++ -std=gnu++11 -O2 -I../../src double_bench.cpp -o double_bench && ./double_bench
+*/
+
+#include "bench.h"
+
+static const size_t CORPUS_SIZE = 4096;
+static const size_t ROUNDS = 2000;
+
+static char corpus[CORPUS_SIZE][32];
+
+// a fixed pseudo-random sequence, so every run parses the same numbers
+static uint64_t nextRandom() {
+    static uint64_t state = 0x9E3779B97F4A7C15ULL;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// fills `corpus` with numbers like a command line would have: mostly short decimals, plus some that take the `strtod` fallback
+static void fillCorpus() {
+    for (size_t i = 0; i < CORPUS_SIZE; i ++) {
+        uint64_t r = nextRandom();
+        long long whole = (long long)(r % 100000) - 50000;
+        unsigned fraction = (unsigned)((r >> 20) % 1000);
+        switch ((r >> 40) % 8) {
+            case 0: snprintf(corpus[i], sizeof(corpus[i]), "%lld", whole); break;
+            case 1: snprintf(corpus[i], sizeof(corpus[i]), "0x%llX", (unsigned long long)(r >> 44)); break;
+            case 2: snprintf(corpus[i], sizeof(corpus[i]), "%lld.%03ue%d", whole, fraction, (int)((r >> 50) % 40) - 20); break;
+            case 3: snprintf(corpus[i], sizeof(corpus[i]), "%.17g", (double)(r >> 11) / 9007199254740992.0 * 1e6); break; // 17 digits, past the fast path
+            default: snprintf(corpus[i], sizeof(corpus[i]), "%lld.%03u", whole, fraction); break;
+        }
+    }
+}
+
+int main() {
+    fillCorpus();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < CORPUS_SIZE; i ++) {
+        double parsed, expected = strtod(corpus[i], nullptr);
+        size_t bytesRead = strToDouble(corpus[i], &parsed);
+        if (bytesRead != strlen(corpus[i]) || memcmp(&parsed, &expected, sizeof(double)) != 0) {
+            if (mismatches ++ < 10) { printf("mismatch: \"%s\" gave %.17g, strtod gave %.17g\n", corpus[i], parsed, expected); }
+        }
+    }
+
+    double sum = 0;
+    double start = benchSeconds();
+    for (size_t round = 0; round < ROUNDS; round ++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i ++) {
+            double value;
+            strToDouble(corpus[i], &value);
+            sum += value;
+        }
+    }
+    double strToDoubleSeconds = benchSeconds() - start;
+
+    start = benchSeconds();
+    for (size_t round = 0; round < ROUNDS; round ++) {
+        for (size_t i = 0; i < CORPUS_SIZE; i ++) { sum += strtod(corpus[i], nullptr); }
+    }
+    double strtodSeconds = benchSeconds() - start;
+    benchKeep(sum);
+
+    double count = (double)ROUNDS * CORPUS_SIZE;
+    printf("strToDouble: %.1f ns per number\n", strToDoubleSeconds / count * 1e9);
+    printf("strtod:      %.1f ns per number\n", strtodSeconds / count * 1e9);
+    printf("%zu of %zu numbers differed from strtod\n", mismatches, CORPUS_SIZE);
+    return mismatches == 0 ? 0 : 1;
+}
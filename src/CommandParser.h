@@ -13,7 +13,65 @@
 #ifndef __COMMAND_PARSER_H__
 #define __COMMAND_PARSER_H__
 
+#include <float.h>
 #include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+class __FlashStringHelper; // Arduino's type for strings wrapped in `F(...)`
+
+// a string argument that isn't null-terminated, pointing into the command itself where possible rather than being copied
+struct CommandParserStringView {
+    const char *ptr;
+    size_t len;
+};
+
+// tag type for choosing how to parse an argument of a given type at compile time
+template<char ARG_TYPE> struct CommandParserArgType {};
+
+// the argument type character for each type that typed command callbacks can take as a parameter, or `'\0'` for unsupported types
+template<typename T> struct CommandParserArgTypeOf { static const char VALUE = '\0'; };
+template<> struct CommandParserArgTypeOf<double> { static const char VALUE = 'd'; };
+template<> struct CommandParserArgTypeOf<uint64_t> { static const char VALUE = 'u'; };
+template<> struct CommandParserArgTypeOf<int64_t> { static const char VALUE = 'i'; };
+template<> struct CommandParserArgTypeOf<uint32_t> { static const char VALUE = 'L'; };
+template<> struct CommandParserArgTypeOf<int32_t> { static const char VALUE = 'l'; };
+template<> struct CommandParserArgTypeOf<uint16_t> { static const char VALUE = 'H'; };
+template<> struct CommandParserArgTypeOf<int16_t> { static const char VALUE = 'h'; };
+template<> struct CommandParserArgTypeOf<uint8_t> { static const char VALUE = 'B'; };
+template<> struct CommandParserArgTypeOf<int8_t> { static const char VALUE = 'b'; };
+template<> struct CommandParserArgTypeOf<const char *> { static const char VALUE = 's'; };
+template<> struct CommandParserArgTypeOf<CommandParserStringView> { static const char VALUE = 'v'; };
+
+// small stand-ins for parts of `<type_traits>`, which isn't available on AVR
+template<typename... TYPES> struct CommandParserTypeList {};
+template<typename A, typename B> struct CommandParserIsSame { static const bool VALUE = false; };
+template<typename A> struct CommandParserIsSame<A, A> { static const bool VALUE = true; };
+template<bool CONDITION, typename T> struct CommandParserEnableIf {};
+template<typename T> struct CommandParserEnableIf<true, T> { typedef T Type; };
+
+// splits the parameter types of a callback into `Args`, a `CommandParserTypeList` of all but the last, and `Last`
+template<typename ARGS, typename... PARAMS> struct CommandParserSignature {};
+template<typename... ARGS, typename LAST> struct CommandParserSignature<CommandParserTypeList<ARGS...>, LAST> {
+    typedef CommandParserTypeList<ARGS...> Args;
+    typedef LAST Last;
+};
+template<typename... ARGS, typename NEXT, typename... REST> struct CommandParserSignature<CommandParserTypeList<ARGS...>, NEXT, REST...> : CommandParserSignature<CommandParserTypeList<ARGS..., NEXT>, REST...> {};
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+#ifndef PROGMEM // not building for an Arduino core (e.g., compiling on a desktop), so there is no separate flash address space
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#define strlen_P strlen
+#endif
+#ifndef pgm_read_ptr
+#define pgm_read_ptr(address) (*(void * const *)(address))
+#endif
 
 /*
 #include <cstring>
@@ -24,80 +82,1066 @@ size_t strlcpy(char *dst, const char *src, size_t size) {
 }
 */
 
+// the value of `c` as a hexadecimal digit, or 0xFF if it isn't one, from a table in flash so that checking a digit in any base is one lookup and one comparison
+inline uint8_t strToIntDigitValue(char c) {
+    const uint8_t X = 0xFF;
+    static const uint8_t values[128] PROGMEM = {
+        X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+        X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+        X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, X, X, X, X, X, X,
+        X, 10, 11, 12, 13, 14, 15, X, X, X, X, X, X, X, X, X,
+        X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+        X, 10, 11, 12, 13, 14, 15, X, X, X, X, X, X, X, X, X,
+        X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X
+    };
+    return (uint8_t)c < 128 ? pgm_read_byte(&values[(uint8_t)c]) : X;
+}
+
+// the value of `c` as a digit in `base` (2, 8, 10, or 16), or -1 if it isn't one
+inline int strToIntDigit(char c, int base) {
+    uint8_t digit = strToIntDigitValue(c);
+    return digit < base ? digit : -1;
+}
+
+// the unsigned integer type with the same size as a given integer type
+template<size_t SIZE> struct CommandParserUIntOfSize;
+template<> struct CommandParserUIntOfSize<1> { typedef uint8_t Type; };
+template<> struct CommandParserUIntOfSize<2> { typedef uint16_t Type; };
+template<> struct CommandParserUIntOfSize<4> { typedef uint32_t Type; };
+template<> struct CommandParserUIntOfSize<8> { typedef uint64_t Type; };
+
+// appends `digit` to `*magnitude` in `BASE`, returning `false` instead if the result wouldn't fit in `U`
+// the `max / BASE` and `max % BASE` cutoffs are compile-time constants, so there are no divisions at runtime
+template<typename U, int BASE> bool strToIntAccumulate(U *magnitude, U digit) {
+    constexpr U CUTOFF = (U)~(U)0 / BASE, CUTLIM = (U)~(U)0 % BASE;
+    if (*magnitude > CUTOFF || (*magnitude == CUTOFF && digit > CUTLIM)) { return false; } // integer multiplication/addition overflow, fail gracefully
+    *magnitude = *magnitude * BASE + digit;
+    return true;
+}
+
+// gives `*value` the sign `isNegative` and the size `magnitude`, returning `false` instead if that's outside `min_value` to `max_value`
+template<typename T, typename M> bool strToIntApplySign(M magnitude, bool isNegative, T *value, T min_value, T max_value) {
+    typedef typename CommandParserUIntOfSize<sizeof(T)>::Type U; // all arithmetic is done at the width of `T`
+    if (isNegative ? min_value > 0 || magnitude > (U)(0 - (U)min_value) : max_value < 0 || magnitude > (U)max_value) { return false; }
+    *value = isNegative ? (T)(U)(0 - (U)magnitude) : (T)magnitude;
+    return true;
+}
+
+// converts 8 decimal digits at once, using SWAR (SIMD within a register) arithmetic on their ASCII codes; the first digit is the most significant
+inline uint32_t strToIntEightDecimalDigits(const char *digits) {
+    uint64_t chunk;
+    memcpy(&chunk, digits, sizeof(chunk));
+    chunk -= 0x3030303030303030; // ASCII to digit values, one per byte
+    chunk = chunk * 10 + (chunk >> 8); // each even byte is now a 2-digit number
+    chunk = ((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) + ((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >> 32; // combine the four 2-digit numbers
+    return (uint32_t)chunk;
+}
+
+// like `strToIntEightDecimalDigits`, but for 8 hexadecimal digits
+inline uint32_t strToIntEightHexDigits(const char *digits) {
+    uint64_t chunk;
+    memcpy(&chunk, digits, sizeof(chunk));
+    chunk = (chunk & 0x0F0F0F0F0F0F0F0F) + ((chunk >> 6) & 0x0101010101010101) * 9; // '0' to '9' have bit 6 clear, while 'a' to 'f' and 'A' to 'F' have it set and a low nibble of 1 to 6
+    chunk = ((chunk << 4) | (chunk >> 8)) & 0x00FF00FF00FF00FF; // pairs of nibbles into bytes
+    chunk = ((chunk << 8) | (chunk >> 16)) & 0x0000FFFF0000FFFF; // pairs of bytes into 16-bit words
+    return (uint32_t)((chunk << 16) | (chunk >> 32));
+}
+
+// the most digits in `base` that always fit in an integer whose largest value is `max`; one more digit might, and two more never do
+constexpr size_t strToIntSafeDigits(uint64_t max, uint64_t base, uint64_t largest = 0) {
+    return largest > (max - (base - 1)) / base ? 0 : 1 + strToIntSafeDigits(max, base, largest * base + base - 1);
+}
+
+// parses the digits at the start of `buf` in `BASE` into `*magnitude`, returning the number of digits, or 0 if there are none or the value doesn't fit in `U`
+// everything that depends on the base and width is a compile-time constant here, including the cutoffs that `strToIntAccumulate` checks the one digit that might overflow against
+template<typename U, int BASE> size_t strToIntDigits(const char *buf, U *magnitude) {
+    constexpr U MAX = (U)~(U)0;
+    constexpr size_t SAFE_DIGITS = strToIntSafeDigits(MAX, BASE);
+
+    // find the digits first, so that they can be converted several at a time without reading past the end of `buf`
+    size_t position = 0;
+    while (buf[position] == '0') { position ++; } // leading zeros don't count towards overflow
+    size_t start = position;
+    while (strToIntDigitValue(buf[position]) < BASE) { position ++; }
+    size_t count = position - start;
+    if (position == 0 || count > SAFE_DIGITS + 1) { return 0; }
+
+    size_t end = start + (count < SAFE_DIGITS ? count : SAFE_DIGITS), i = start;
+    U result = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ // the SWAR conversions assume the first character is in the lowest byte
+    if ((sizeof(U) == 8 || (sizeof(U) == 4 && sizeof(size_t) == 8)) && (BASE == 10 || BASE == 16)) { // 64-bit values, or 32-bit ones where 64-bit arithmetic is native
+        uint64_t wide = 0;
+        for (; i + 8 <= end; i += 8) { wide = BASE == 10 ? wide * 100000000 + strToIntEightDecimalDigits(buf + i) : (wide << 32) | strToIntEightHexDigits(buf + i); }
+        result = (U)wide;
+    }
+#endif
+    for (; i < end; i ++) { result = result * BASE + strToIntDigitValue(buf[i]); }
+    if (count > SAFE_DIGITS && !strToIntAccumulate<U, BASE>(&result, strToIntDigitValue(buf[position - 1]))) { return 0; }
+    *magnitude = result;
+    return position;
+}
+
 // avr-libc lacks strtoll and strtoull (see https://www.nongnu.org/avr-libc/user-manual/group__avr__stdlib.html), so we'll implement our own to be compatible with AVR boards such as the Arduino Uno
 // typically you would use this like: `int64_t result; size_t bytesRead = strToInt<int64_t>("-0x123", &result, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max())`
 // if an error occurs during parsing, `bytesRead` will be 0 and `result` will be an arbitrary value
+// `min_value` must be at most 0 and `max_value` must be at least 0
 template<typename T> size_t strToInt(const char* buf, T *value, T min_value, T max_value) {
+    typedef typename CommandParserUIntOfSize<sizeof(T)>::Type U; // all arithmetic is done at the width of `T`
     size_t position = 0;
 
-    // parse sign if necessary
+    // parse sign if necessary; a '-' is always consumed so that the range check rejects negative values for unsigned types
     bool isNegative = false;
-    if (min_value < 0 && buf[position] == '+' || buf[position] == '-') {
+    if ((min_value < 0 && buf[position] == '+') || buf[position] == '-') {
         isNegative = buf[position] == '-';
         position ++;
     }
 
-    // parse base identifier if necessary
-    int base = 10;
+    // parse base identifier if necessary, then the digits with the parser for that base
+    U magnitude;
+    size_t digits;
     if (buf[position] == '0' && buf[position + 1] == 'b') {
-        base = 2;
+        digits = strToIntDigits<U, 2>(buf + position + 2, &magnitude);
         position += 2;
     } else if (buf[position] == '0' && buf[position + 1] == 'o') {
-        base = 8;
+        digits = strToIntDigits<U, 8>(buf + position + 2, &magnitude);
         position += 2;
     } else if (buf[position] == '0' && buf[position + 1] == 'x') {
-        base = 16;
+        digits = strToIntDigits<U, 16>(buf + position + 2, &magnitude);
         position += 2;
+    } else {
+        digits = strToIntDigits<U, 10>(buf + position, &magnitude);
     }
+    if (digits == 0) { return 0; }
+
+    // range check the magnitude once against `min_value` and `max_value`
+    if (!strToIntApplySign(magnitude, isNegative, value, min_value, max_value)) { return 0; }
+    return position + digits;
+}
+
+// largest `k` such that `5^k <= limit`; with `limit = 2^DBL_MANT_DIG`, every power of ten up to `10^k` is exactly representable as a double
+constexpr int strToDoubleMaxExactPowerOfTen(uint64_t limit, int k = 0, uint64_t power = 1) {
+    return power > limit / 5 ? k : strToDoubleMaxExactPowerOfTen(limit, k + 1, power * 5);
+}
 
-    int digit = -1;
-    *value = 0;
-    while (true) {
-        // obtain the next digit of the number
-        if      (base >= 2  && '0' <= buf[position] && buf[position] <= '1') { digit = buf[position] - '0'; }
-        else if (base >= 8  && '2' <= buf[position] && buf[position] <= '7') { digit = (buf[position] - '2') + 2; }
-        else if (base >= 10 && '8' <= buf[position] && buf[position] <= '9') { digit = (buf[position] - '8') + 8; }
-        else if (base >= 16 && 'a' <= buf[position] && buf[position] <= 'f') { digit = (buf[position] - 'a') + 10; }
-        else if (base >= 16 && 'A' <= buf[position] && buf[position] <= 'F') { digit = (buf[position] - 'A') + 10; }
-        else { break; }
-
-        if (*value < min_value / base || *value > max_value / base) { return 0; } // integer multiplication underflow/overflow, fail gracefully
-        *value *= base;
-        if (isNegative ? *value < min_value + digit : *value > max_value - digit) { return 0; } // integer subtraction-underflow/addition-overflow, fail gracefully
-        *value += digit;
+// parses a double of the form `ARG_DOUBLE` from the grammar in the README, or an integer with a `0b`, `0o`, or `0x` prefix like `strToInt` accepts, returning the number of characters read like `strToInt` does
+// when the significant digits and the power of ten are both exactly representable (e.g., up to 15 digits and `1e22` with 64-bit doubles), the result is one correctly rounded multiplication or division (Clinger's fast path); anything else, such as `inf`, hex floats, or 20+ significant digits, falls back to `strtod`
+inline size_t strToDouble(const char *buf, double *value) {
+    static const double powersOfTen[] PROGMEM = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const uint64_t MAX_EXACT_MANTISSA = (uint64_t)1 << DBL_MANT_DIG;
+    const int MAX_EXACT_EXPONENT = strToDoubleMaxExactPowerOfTen((uint64_t)1 << DBL_MANT_DIG);
+    static_assert(strToDoubleMaxExactPowerOfTen((uint64_t)1 << DBL_MANT_DIG) < (int)(sizeof(powersOfTen) / sizeof(powersOfTen[0])), "powersOfTen must cover every exact power of ten");
 
-        position ++;
+    size_t position = 0;
+    bool isNegative = buf[position] == '-';
+    if (buf[position] == '+' || buf[position] == '-') { position ++; }
+
+    // integers with a base prefix are parsed by `strToInt`, then rounded once when converting to double
+    if (buf[position] == '0' && (buf[position + 1] == 'b' || buf[position + 1] == 'o' || buf[position + 1] == 'x')) {
+        uint64_t integer;
+        size_t bytesRead = strToInt<uint64_t>(buf + position, &integer, 0, ULONG_LONG_MAX);
+        if (bytesRead > 0 && (buf[position + bytesRead] == ' ' || buf[position + bytesRead] == '\0')) {
+            *value = isNegative ? -(double)integer : (double)integer;
+            return position + bytesRead;
+        }
+        goto fallback; // hex floats like `0x1.8p1`, or integers too large for 64 bits
+    }
+
+    {
+        // collect up to 19 significant digits (the most that always fit in 64 bits), ignoring leading zeros and tracking the decimal exponent separately
+        uint64_t mantissa = 0;
+        int significantDigits = 0, exponent = 0;
+        bool hasDigits = false, isInexact = false;
+        for (; '0' <= buf[position] && buf[position] <= '9'; position ++) {
+            hasDigits = true;
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + (buf[position] - '0');
+                if (mantissa != 0) { significantDigits ++; }
+            } else {
+                exponent ++;
+                isInexact = isInexact || buf[position] != '0';
+            }
+        }
+        if (buf[position] == '.') {
+            position ++;
+            for (; '0' <= buf[position] && buf[position] <= '9'; position ++) {
+                hasDigits = true;
+                if (significantDigits < 19) {
+                    mantissa = mantissa * 10 + (buf[position] - '0');
+                    if (mantissa != 0) { significantDigits ++; }
+                    exponent --;
+                } else {
+                    isInexact = isInexact || buf[position] != '0';
+                }
+            }
+        }
+        if (!hasDigits) { goto fallback; } // `inf`, `nan`, or not a number at all
+        if ((buf[position] == 'e' || buf[position] == 'E') && ((buf[position + 1] >= '0' && buf[position + 1] <= '9') || ((buf[position + 1] == '+' || buf[position + 1] == '-') && buf[position + 2] >= '0' && buf[position + 2] <= '9'))) {
+            position ++;
+            bool isExponentNegative = buf[position] == '-';
+            if (buf[position] == '+' || buf[position] == '-') { position ++; }
+            int exponentValue = 0;
+            for (; '0' <= buf[position] && buf[position] <= '9'; position ++) {
+                if (exponentValue < 10000) { exponentValue = exponentValue * 10 + (buf[position] - '0'); } // anything this large over/underflows anyway, so `strtod` can deal with it
+            }
+            exponent += isExponentNegative ? -exponentValue : exponentValue;
+        }
+        if (isInexact) { goto fallback; }
+
+        // a small mantissa can absorb some of a large exponent while staying exact, e.g. `1e25` is `1000 * 1e22`
+        while (exponent > MAX_EXACT_EXPONENT && mantissa != 0 && mantissa <= MAX_EXACT_MANTISSA / 10) {
+            mantissa *= 10;
+            exponent --;
+        }
+        if (mantissa == 0) {
+            *value = isNegative ? -0.0 : 0.0;
+            return position;
+        }
+        if (mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_EXPONENT && exponent <= MAX_EXACT_EXPONENT) {
+            double powerOfTen;
+            memcpy_P(&powerOfTen, &powersOfTen[exponent < 0 ? -exponent : exponent], sizeof(powerOfTen));
+            double result = exponent < 0 ? (double)mantissa / powerOfTen : (double)mantissa * powerOfTen;
+            *value = isNegative ? -result : result;
+            return position;
+        }
     }
-    return digit == -1 ? 0 : position; // ensure that there is at least one digit
+
+fallback:
+    char *after;
+    *value = strtod(buf, &after);
+    return after - buf;
+}
+
+// smallest power of two that is at least `n`, used to size the open-addressing command index
+constexpr size_t commandParserPowerOfTwo(size_t n, size_t power = 1) {
+    return power >= n ? power : commandParserPowerOfTwo(n, power * 2);
+}
+
+// `CommandParserUInt<N>::Type` is the smallest unsigned integer type that can hold values from 0 to N inclusive
+template<size_t N, bool FITS_IN_BYTE = (N <= 0xFF)> struct CommandParserUInt { typedef uint8_t Type; };
+template<size_t N> struct CommandParserUInt<N, false> { typedef uint16_t Type; };
+
+// one step of the hash used to index command names; this is a 16-bit variant of djb2, which only needs shifts, adds, and XORs so it stays cheap on 8-bit AVRs
+constexpr uint16_t commandNameHashStep(uint16_t hash, char c) {
+    return (uint16_t)((uint16_t)((hash << 5) + hash) ^ (uint8_t)c);
+}
+constexpr uint16_t COMMAND_NAME_HASH_SEED = 5381;
+
+// fed to the streaming parser, this byte (ASCII CAN, or Ctrl+X in a terminal) throws away the line it's in
+constexpr char COMMAND_CANCEL_LINE = '\x18';
+
+// scrambles a command name hash with a seed, so that the compile-time perfect hash tables can pick a seed per bucket that moves its names into free slots
+constexpr uint16_t commandNameHashMix(uint16_t hash, uint16_t seed) {
+    return (uint16_t)((uint16_t)((hash ^ seed) * 0x9E37u) ^ ((uint16_t)((hash ^ seed) * 0x9E37u) >> 8));
 }
 
-template<size_t COMMANDS = 16, size_t COMMAND_ARGS = 4, size_t COMMAND_NAME_LENGTH = 10, size_t COMMAND_ARG_SIZE = 32, size_t RESPONSE_SIZE = 64>
-class CommandParser {
+// lookup policies decide how `CommandParser` finds registered commands by name, and are selected with its `LOOKUP` template argument
+// each policy has an `Index<MAX_COMMANDS, MAX_NAME_LENGTH>` class template that the parser inherits from (so that policies without any state take up no space), and updates as commands are registered
+// given the parser's table of registered commands, `insertPosition` says where in the table a new command goes, `inserted` is called once it is there, and `find` returns the position of a matching command (or `table.size()` if there is none)
+
+// scans the registered commands in order, using no extra memory; this is the default
+struct LinearCommandLookup {
+    template<size_t MAX_COMMANDS, size_t MAX_NAME_LENGTH> class Index {
+        public:
+            template<typename TABLE> size_t insertPosition(const TABLE &table, const char *, size_t) const { return table.size(); }
+            template<typename TABLE> void inserted(const TABLE &, size_t, uint16_t) {}
+            template<typename TABLE> size_t find(const TABLE &table, const char *name, size_t nameLength, uint16_t hash) const {
+                for (size_t i = 0; i < table.size(); i ++) {
+                    if (table.matches(i, name, nameLength, hash)) { return i; }
+                }
+                return table.size();
+            }
+    };
+};
+
+// keeps an open-addressing hash table of registered commands, which uses 2 * COMMANDS slots (rounded up to a power of two) of 1 byte each (2 bytes if COMMANDS is over 255)
+struct HashCommandLookup {
+    template<size_t MAX_COMMANDS, size_t MAX_NAME_LENGTH> class Index {
+        private:
+            // linear probing, kept at most half full so that probe sequences stay short
+            static const size_t INDEX_SIZE = commandParserPowerOfTwo(2 * MAX_COMMANDS);
+            typedef typename CommandParserUInt<MAX_COMMANDS>::Type Slot;
+            Slot slots[INDEX_SIZE] = {}; // each slot is either 0 (empty) or 1 plus the position of a command in the table
+        public:
+            template<typename TABLE> size_t insertPosition(const TABLE &table, const char *, size_t) const { return table.size(); }
+            template<typename TABLE> void inserted(const TABLE &, size_t position, uint16_t hash) {
+                // if the name is already registered, the earlier command comes first in the probe sequence and keeps taking precedence
+                size_t slot = hash & (INDEX_SIZE - 1);
+                while (slots[slot] != 0) { slot = (slot + 1) & (INDEX_SIZE - 1); }
+                slots[slot] = (Slot)(position + 1);
+            }
+            template<typename TABLE> size_t find(const TABLE &table, const char *name, size_t nameLength, uint16_t hash) const {
+                for (size_t slot = hash & (INDEX_SIZE - 1); slots[slot] != 0; slot = (slot + 1) & (INDEX_SIZE - 1)) {
+                    if (table.matches(slots[slot] - 1, name, nameLength, hash)) { return slots[slot] - 1; }
+                }
+                return table.size();
+            }
+    };
+};
+
+// keeps the registered commands sorted by name, and binary searches them, using no extra memory
+struct SortedCommandLookup {
+    template<size_t MAX_COMMANDS, size_t MAX_NAME_LENGTH> class Index {
+        public:
+            template<typename TABLE> size_t insertPosition(const TABLE &table, const char *name, size_t nameLength) const {
+                // insert after any commands with the same name, so that the earliest registration keeps taking precedence
+                size_t low = 0, high = table.size();
+                while (low < high) {
+                    size_t middle = low + (high - low) / 2;
+                    if (table.compare(middle, name, nameLength) <= 0) { low = middle + 1; } else { high = middle; }
+                }
+                return low;
+            }
+            template<typename TABLE> void inserted(const TABLE &, size_t, uint16_t) {}
+            template<typename TABLE> size_t find(const TABLE &table, const char *name, size_t nameLength, uint16_t) const {
+                size_t low = 0, high = table.size();
+                while (low < high) {
+                    size_t middle = low + (high - low) / 2;
+                    if (table.compare(middle, name, nameLength) < 0) { low = middle + 1; } else { high = middle; }
+                }
+                return low < table.size() && table.compare(low, name, nameLength) == 0 ? low : table.size();
+            }
+    };
+};
+
+// keeps a radix tree over the registered command names, in a pool of 2 * COMMANDS + 1 nodes of 6 bytes each (more if there are over 255 commands or the names are over 255 bytes long)
+// lookups take time proportional to the length of the name, and also accept any prefix that is shared by only one command, so "sta" finds "status" unless there's also a command like "start"
+struct TrieCommandLookup {
+    template<size_t MAX_COMMANDS, size_t MAX_NAME_LENGTH> class Index {
+        private:
+            // each insertion adds at most a leaf and the node that splits an existing edge to make room for it
+            static const size_t MAX_NODES = 2 * MAX_COMMANDS + 1;
+            typedef typename CommandParserUInt<MAX_NODES>::Type NodeRef; // 0 means no node, since the root (node 0) is never a child
+            typedef typename CommandParserUInt<MAX_COMMANDS>::Type CommandRef; // 0 means no command, otherwise 1 plus the position of a command in the table
+            typedef typename CommandParserUInt<MAX_NAME_LENGTH>::Type Depth;
+
+            // the edge into a node is labelled with bytes of `labelCommand`'s name, from the depth of the parent node up to the depth of this one
+            struct Node {
+                CommandRef labelCommand;
+                Depth depth;
+                NodeRef firstChild;
+                NodeRef nextSibling;
+                CommandRef command; // the command whose name ends at this node, if any
+                CommandRef onlyCommand; // the command in this node's subtree, if there is exactly one (so that a prefix ending here is unambiguous)
+            };
+
+            Node nodes[MAX_NODES] = {};
+            NodeRef numNodes = 1;
+
+            // accessors for the bytes of the name being looked up or inserted, which may be in the input or in the table
+            struct InputName {
+                const char *name;
+                char operator[](size_t offset) const { return name[offset]; }
+            };
+            template<typename TABLE> struct TableName {
+                const TABLE &table;
+                size_t position;
+                char operator[](size_t offset) const { return table.nameCharacter(position, offset); }
+            };
+
+            // finds the child of `node` whose edge starts with `c`, returning a pointer to the link that refers to it (which holds 0 if there is no such child)
+            template<typename TABLE> const NodeRef *findChild(const TABLE &table, NodeRef node, char c) const {
+                const NodeRef *link = &nodes[node].firstChild;
+                while (*link != 0 && table.nameCharacter(nodes[*link].labelCommand - 1, nodes[node].depth) != c) { link = &nodes[*link].nextSibling; }
+                return link;
+            }
+
+            template<typename TABLE, typename NAME> size_t search(const TABLE &table, const NAME &name, size_t nameLength, bool allowPrefix) const {
+                NodeRef node = 0;
+                while (nodes[node].depth < nameLength) {
+                    NodeRef child = *findChild(table, node, name[nodes[node].depth]);
+                    if (child == 0) { return table.size(); }
+                    size_t depth = nodes[node].depth + 1;
+                    for (; depth < nodes[child].depth && depth < nameLength; depth ++) {
+                        if (table.nameCharacter(nodes[child].labelCommand - 1, depth) != name[depth]) { return table.size(); }
+                    }
+                    if (depth < nodes[child].depth) { // the name ends partway along the edge into `child`
+                        return allowPrefix && nodes[child].onlyCommand != 0 ? nodes[child].onlyCommand - 1 : table.size();
+                    }
+                    node = child;
+                }
+                if (nodes[node].command != 0) { return nodes[node].command - 1; }
+                return allowPrefix && node != 0 && nodes[node].onlyCommand != 0 ? nodes[node].onlyCommand - 1 : table.size();
+            }
+        public:
+            template<typename TABLE> size_t insertPosition(const TABLE &table, const char *, size_t) const { return table.size(); }
+            template<typename TABLE> void inserted(const TABLE &table, size_t position, uint16_t) {
+                TableName<TABLE> name = {table, position};
+                size_t nameLength = table.nameLength(position);
+                if (search(table, name, nameLength, false) < position) { return; } // the name is already registered, and the earlier command keeps taking precedence
+
+                NodeRef node = 0;
+                while (nodes[node].depth < nameLength) {
+                    NodeRef *link = const_cast<NodeRef *>(findChild(table, node, name[nodes[node].depth]));
+                    NodeRef child = *link;
+                    if (child == 0) { // no edge shares a first byte with the rest of the name, so add a leaf
+                        Node &leaf = nodes[numNodes];
+                        leaf.labelCommand = leaf.command = leaf.onlyCommand = position + 1;
+                        leaf.depth = nameLength;
+                        *link = numNodes ++;
+                        return;
+                    }
+
+                    size_t depth = nodes[node].depth + 1;
+                    while (depth < nodes[child].depth && depth < nameLength && table.nameCharacter(nodes[child].labelCommand - 1, depth) == name[depth]) { depth ++; }
+                    if (depth < nodes[child].depth) { // the name diverges from (or ends partway along) the edge into `child`, so split that edge
+                        Node &middle = nodes[numNodes];
+                        middle.labelCommand = nodes[child].labelCommand;
+                        middle.depth = depth;
+                        middle.firstChild = child;
+                        middle.nextSibling = nodes[child].nextSibling;
+                        nodes[child].nextSibling = 0;
+                        *link = numNodes ++;
+                        child = *link;
+                    }
+                    nodes[child].onlyCommand = 0; // the subtree already had a command, and now has this one too
+                    node = child;
+                }
+                nodes[node].command = position + 1;
+            }
+            template<typename TABLE> size_t find(const TABLE &table, const char *name, size_t nameLength, uint16_t) const {
+                InputName inputName = {name};
+                return search(table, inputName, nameLength, true);
+            }
+    };
+};
+
+// storage policies decide where `CommandParser` keeps the names and argument types of registered commands, and are selected with its `STORAGE` template argument
+// each policy has a `Table<MAX_COMMANDS, MAX_ARGS, MAX_NAME_LENGTH, HANDLER>` class template, holding the registered commands in the order chosen by the lookup policy
+// commands are inserted with their name and argument types in RAM, plus the same strings in flash if they were registered from PROGMEM (or `nullptr` otherwise); `insert` returns `false` if the storage can't hold them
+// `ACCEPTS_RAM_STRINGS` says whether commands registered from RAM strings can be kept, so registering them with a policy that can't is a compile error rather than a call that always fails
+
+// copies names and argument types into RAM, so registered strings don't need to outlive the call to `registerCommand`; this is the default
+// this is laid out as a struct of arrays, so that scanning for a name only touches the packed hashes and lengths until a likely match turns up, and never the argument types or handlers
+struct RamCommandStorage {
+    static const bool ACCEPTS_RAM_STRINGS = true;
+
+    template<size_t MAX_COMMANDS, size_t MAX_ARGS, size_t MAX_NAME_LENGTH, typename HANDLER> class Table {
+        public:
+            size_t size() const { return numCommands; }
+
+            // whether the name of the command at `position` is exactly the `nameLength` bytes at `name`, which hash to `hash`
+            bool matches(size_t position, const char *name, size_t nameLength, uint16_t hash) const {
+                return nameHashes[position] == hash && nameLengths[position] == nameLength && memcmp(names[position], name, nameLength) == 0;
+            }
+
+            // compares the name of the command at `position` with the `nameLength` bytes at `name`, like `strcmp`
+            int compare(size_t position, const char *name, size_t nameLength) const {
+                int result = memcmp(names[position], name, nameLengths[position] < nameLength ? nameLengths[position] : nameLength);
+                if (result != 0) { return result; }
+                return (int)nameLengths[position] - (int)nameLength; // one name is a prefix of the other, so the shorter one comes first
+            }
+
+            size_t nameLength(size_t position) const { return nameLengths[position]; }
+            char nameCharacter(size_t position, size_t offset) const { return names[position][offset]; }
+            const char *argTypes(size_t position, char *) const { return commandArgTypes[position]; }
+            const HANDLER &handler(size_t position) const { return handlers[position]; }
+
+            // moves the commands at `position` and after up by one to make room; arguments must already be validated, and the table must not be full
+            bool insert(size_t position, const char *name, size_t nameLength, uint16_t hash, const char *argTypes, const HANDLER &handler, const char *, const char *) {
+                size_t moved = numCommands - position;
+                memmove(&nameHashes[position + 1], &nameHashes[position], moved * sizeof(nameHashes[0]));
+                memmove(&nameLengths[position + 1], &nameLengths[position], moved * sizeof(nameLengths[0]));
+                memmove(&names[position + 1], &names[position], moved * sizeof(names[0]));
+                memmove(&commandArgTypes[position + 1], &commandArgTypes[position], moved * sizeof(commandArgTypes[0]));
+                memmove(&handlers[position + 1], &handlers[position], moved * sizeof(handlers[0]));
+                nameHashes[position] = hash;
+                nameLengths[position] = nameLength;
+                memcpy(names[position], name, nameLength);
+                strlcpy(commandArgTypes[position], argTypes, MAX_ARGS + 1);
+                handlers[position] = handler;
+                numCommands ++;
+                return true;
+            }
+        private:
+            uint16_t nameHashes[MAX_COMMANDS];
+            typename CommandParserUInt<MAX_NAME_LENGTH>::Type nameLengths[MAX_COMMANDS];
+            char names[MAX_COMMANDS][MAX_NAME_LENGTH]; // not null-terminated, since the lengths are stored separately
+            char commandArgTypes[MAX_COMMANDS][MAX_ARGS + 1];
+            HANDLER handlers[MAX_COMMANDS]; // the callback, and anything else the parser needs to run the command
+            size_t numCommands = 0;
+    };
+};
+
+// keeps only pointers to names and argument types that are stored in flash, for boards such as the Arduino Uno where RAM is scarce
+// commands must be registered with `registerCommand(F("..."), F("..."), ...)` or `registerCommand_P`, and registering RAM strings doesn't compile
+// on AVR, each command takes 7 bytes of RAM plus its handler, rather than `COMMAND_NAME_LENGTH + COMMAND_ARGS + 4` bytes plus its handler
+struct ProgmemCommandStorage {
+    static const bool ACCEPTS_RAM_STRINGS = false;
+
+    template<size_t MAX_COMMANDS, size_t MAX_ARGS, size_t MAX_NAME_LENGTH, typename HANDLER> class Table {
+        public:
+            size_t size() const { return numCommands; }
+
+            bool matches(size_t position, const char *name, size_t nameLength, uint16_t hash) const {
+                return nameHashes[position] == hash && nameLengths[position] == nameLength && memcmp_P(name, names[position], nameLength) == 0;
+            }
+
+            int compare(size_t position, const char *name, size_t nameLength) const {
+                int result = -memcmp_P(name, names[position], nameLengths[position] < nameLength ? nameLengths[position] : nameLength);
+                if (result != 0) { return result; }
+                return (int)nameLengths[position] - (int)nameLength;
+            }
+
+            size_t nameLength(size_t position) const { return nameLengths[position]; }
+            char nameCharacter(size_t position, size_t offset) const { return pgm_read_byte(names[position] + offset); }
+            const char *argTypes(size_t position, char *buffer) const {
+                memcpy_P(buffer, commandArgTypes[position], strlen_P(commandArgTypes[position]) + 1);
+                return buffer;
+            }
+            const HANDLER &handler(size_t position) const { return handlers[position]; }
+
+            bool insert(size_t position, const char *, size_t nameLength, uint16_t hash, const char *, const HANDLER &handler, const char *flashName, const char *flashArgTypes) {
+                if (flashName == nullptr || flashArgTypes == nullptr) { return false; }
+                size_t moved = numCommands - position;
+                memmove(&nameHashes[position + 1], &nameHashes[position], moved * sizeof(nameHashes[0]));
+                memmove(&nameLengths[position + 1], &nameLengths[position], moved * sizeof(nameLengths[0]));
+                memmove(&names[position + 1], &names[position], moved * sizeof(names[0]));
+                memmove(&commandArgTypes[position + 1], &commandArgTypes[position], moved * sizeof(commandArgTypes[0]));
+                memmove(&handlers[position + 1], &handlers[position], moved * sizeof(handlers[0]));
+                nameHashes[position] = hash;
+                nameLengths[position] = nameLength;
+                names[position] = flashName;
+                commandArgTypes[position] = flashArgTypes;
+                handlers[position] = handler;
+                numCommands ++;
+                return true;
+            }
+        private:
+            uint16_t nameHashes[MAX_COMMANDS];
+            typename CommandParserUInt<MAX_NAME_LENGTH>::Type nameLengths[MAX_COMMANDS];
+            const char *names[MAX_COMMANDS]; // in flash, and not null-terminated as far as lookups are concerned
+            const char *commandArgTypes[MAX_COMMANDS]; // in flash
+            HANDLER handlers[MAX_COMMANDS]; // the callback, and anything else the parser needs to run the command
+            size_t numCommands = 0;
+    };
+};
+
+// builds a command's response piece by piece, either into a buffer or straight out to an Arduino `Print` (such as `Serial`) as it's produced, so large responses don't need a buffer of their own
+// anything past the length limit is dropped, and `overflowed` says whether that happened
+class CommandParserResponse {
+    public:
+        // writes into `buffer`, keeping it null-terminated, with room for `size - 1` characters
+        // with a `size` of 0, `buffer` is never touched and everything written counts as overflow
+        CommandParserResponse(char *buffer, size_t size) : buffer(size > 0 ? buffer : nullptr), limit(size > 0 ? size - 1 : 0) {
+            if (size > 0) { buffer[0] = '\0'; }
+        }
+
+        // writes to `sink` as the response is produced, up to `limit` characters
+        template<typename PRINT> explicit CommandParserResponse(PRINT &sink, size_t limit = (size_t)-1) : sink(&sink), sinkWrite(&writeToSink<PRINT>), limit(limit) {}
+
+        size_t write(const char *data, size_t length) {
+            if (length > limit - used) {
+                length = limit - used;
+                overflow = true;
+            }
+            if (buffer != nullptr) {
+                memcpy(buffer + used, data, length);
+                buffer[used + length] = '\0';
+            } else if (length > 0) { // only reached with a sink, since a zero-size buffer has no room at all
+                (*sinkWrite)(sink, data, length);
+            }
+            used += length;
+            return length;
+        }
+        size_t write(char c) { return write(&c, 1); }
+
+        size_t print(const char *text) { return write(text, strlen(text)); }
+        size_t print(const __FlashStringHelper *text) { // a string in flash, such as one wrapped in `F(...)`
+            const char *flash = reinterpret_cast<const char *>(text);
+            char chunk[16];
+            size_t written = 0, length = strlen_P(flash);
+            for (size_t start = 0; start < length; start += sizeof(chunk)) {
+                size_t count = length - start < sizeof(chunk) ? length - start : sizeof(chunk);
+                memcpy_P(chunk, flash + start, count);
+                written += write(chunk, count);
+            }
+            return written;
+        }
+        size_t print(char c) { return write(c); }
+        size_t print(int value) { return printSigned(value); }
+        size_t print(long value) { return printSigned(value); }
+        size_t print(long long value) { return printSigned(value); }
+        size_t print(unsigned int value) { return printUnsigned(value); }
+        size_t print(unsigned long value) { return printUnsigned(value); }
+        size_t print(unsigned long long value) { return printUnsigned(value); }
+
+        // prints `value` with `digits` digits after the decimal point, like Arduino's `Print::print(double, int)`
+        size_t print(double value, int digits = 2) {
+            if (value != value) { return print("nan"); }
+            size_t written = 0;
+            if (value < 0) {
+                written += write('-');
+                value = -value;
+            }
+            if (value > 1.8e19) { return written + print(value == value * 2 ? "inf" : "ovf"); } // too big for the integer part to fit in 64 bits
+            double rounding = 0.5;
+            for (int i = 0; i < digits; i ++) { rounding /= 10; }
+            value += rounding;
+            unsigned long long integer = (unsigned long long)value;
+            written += printUnsigned(integer);
+            if (digits > 0) { written += write('.'); }
+            double remainder = value - (double)integer;
+            for (int i = 0; i < digits; i ++) {
+                remainder *= 10;
+                int digit = (int)remainder;
+                written += write((char)('0' + digit));
+                remainder -= digit;
+            }
+            return written;
+        }
+
+        size_t println() { return write('\n'); }
+        template<typename T> size_t println(T value) {
+            size_t written = print(value);
+            return written + println();
+        }
+
+        // formats like `printf`; when writing to a `Print`, each call formats at most 63 characters
+        size_t printf(const char *format, ...) {
+            char chunk[64];
+            bool direct = buffer != nullptr; // with a zero-size buffer, this formats into `chunk` and `write` drops it all
+            va_list args;
+            va_start(args, format);
+            int length = direct ? vsnprintf(buffer + used, limit - used + 1, format, args) : vsnprintf(chunk, sizeof(chunk), format, args);
+            va_end(args);
+            if (length < 0) { return 0; }
+            if (!direct) {
+                if ((size_t)length >= sizeof(chunk)) {
+                    length = sizeof(chunk) - 1;
+                    overflow = true;
+                }
+                return write(chunk, length);
+            }
+            if ((size_t)length > limit - used) {
+                length = limit - used;
+                overflow = true;
+            }
+            used += length;
+            return length;
+        }
+
+        size_t length() const { return used; } // characters written so far
+        bool overflowed() const { return overflow; } // whether anything was dropped for going past the length limit
+    private:
+        char *buffer = nullptr;
+        void *sink = nullptr;
+        void (*sinkWrite)(void *sink, const char *data, size_t length) = nullptr;
+        size_t limit;
+        size_t used = 0;
+        bool overflow = false;
+
+        template<typename PRINT> static void writeToSink(void *sink, const char *data, size_t length) {
+            static_cast<PRINT *>(sink)->write(reinterpret_cast<const uint8_t *>(data), length);
+        }
+
+        size_t printUnsigned(unsigned long long value) {
+            char digits[20]; // enough for 2^64 - 1
+            size_t start = sizeof(digits);
+            do {
+                digits[-- start] = '0' + value % 10;
+                value /= 10;
+            } while (value != 0);
+            return write(digits + start, sizeof(digits) - start);
+        }
+        size_t printSigned(long long value) {
+            if (value >= 0) { return printUnsigned(value); }
+            size_t written = write('-');
+            return written + printUnsigned(0 - (unsigned long long)value);
+        }
+};
+
+// a lock-free queue of received bytes, for passing input from an interrupt handler to `CommandParser<...>::drain` in the main loop without disabling interrupts
+// `push` must only be called from one context (usually the UART receive interrupt), and everything else only from one other context (usually the main loop)
+// it holds up to SIZE - 1 bytes; on AVR, SIZE can be at most 256 so that each index is a single byte, which is read and written atomically
+// when bytes have to be dropped because it's full, a `COMMAND_CANCEL_LINE` byte is queued where they were lost, so that the parser throws away the damaged line instead of running it (followed by a line end if one was lost, so the line after it isn't thrown away too)
+template<size_t SIZE> class CommandRingBuffer {
+    static_assert(SIZE >= 5, "CommandRingBuffer SIZE must be at least 5"); // room for the longest mark that `push` queues for dropped bytes, and a byte after it
+    static_assert(SIZE - 1 <= 0xFFFF, "CommandRingBuffer SIZE must be at most 65536");
+#if defined(__AVR__)
+    static_assert(SIZE <= 256, "CommandRingBuffer SIZE must be at most 256 on AVR");
+#endif
+    public:
+        static const size_t CAPACITY = SIZE - 1;
+
+        // producer side, safe to call from an interrupt handler; returns `false` if `c` was dropped because the queue was full
+        bool push(char c) {
+            if (dropping) { // bytes were lost since the last one queued, so mark the spot before queueing anything else
+                size_t markLength = 1 + droppedLineEnd + droppedAfterLineEnd;
+                if (CAPACITY - usedBetween(head, tail) < markLength + 1) { return drop(c); }
+                queue(COMMAND_CANCEL_LINE); // throws away the rest of the line that was cut off
+                if (droppedLineEnd) { queue('\n'); } // that line's end was lost, so end it here, or the next line would be thrown away with it
+                if (droppedAfterLineEnd) { queue(COMMAND_CANCEL_LINE); } // the line after it was cut off at the start, so throw that away too
+                dropping = false;
+                droppedLineEnd = false;
+                droppedAfterLineEnd = false;
+            } else if (advance(head) == tail) {
+                overflowCount = overflowCount + 1;
+                dropping = true;
+                return drop(c);
+            }
+            queue(c);
+            size_t used = usedBetween(head, tail);
+            if (used > maxUsed) { maxUsed = used; }
+            return true;
+        }
+
+        // consumer side, with the same interface as the parts of Arduino's `Stream` that `CommandParser<...>::poll` uses for reading
+        int available() const { return (int)usedBetween(head, tail); }
+        int read() {
+            Index position = tail;
+            if (position == head) { return -1; }
+            unsigned char c = data[position];
+            tail = advance(position);
+            return c;
+        }
+
+        // statistics for sizing the queue, which are safe to read from the consumer side while `push` is running
+        size_t droppedBytes() const { return readCounter(droppedCount); } // bytes that didn't fit
+        size_t overflows() const { return readCounter(overflowCount); } // times the queue filled up and started dropping bytes
+        size_t highWaterMark() const { return readCounter(maxUsed); } // the most bytes it has held at once
+    private:
+        typedef typename CommandParserUInt<SIZE - 1>::Type Index;
+        volatile char data[SIZE];
+        volatile Index head = 0; // written only by the producer
+        volatile Index tail = 0; // written only by the consumer
+        volatile bool dropping = false; // whether bytes were dropped since the last one queued
+        volatile bool droppedLineEnd = false; // whether any of those ended a line
+        volatile bool droppedAfterLineEnd = false; // whether any were dropped after the last of those line ends
+        volatile size_t droppedCount = 0, overflowCount = 0, maxUsed = 0; // written only by the producer
+
+        static Index advance(Index position) { return position + 1 == SIZE ? 0 : position + 1; }
+
+        void queue(char c) {
+            data[head] = c;
+            head = advance(head);
+        }
+        bool drop(char c) {
+            droppedCount = droppedCount + 1;
+            bool isLineEnd = c == '\n' || c == '\r';
+            droppedAfterLineEnd = !isLineEnd && droppedLineEnd;
+            if (isLineEnd) { droppedLineEnd = true; }
+            return false;
+        }
+        static size_t usedBetween(Index head, Index tail) { return head >= tail ? head - tail : head + SIZE - tail; }
+
+        // the counters might be wider than what the processor reads atomically, so keep reading until `push` didn't change it partway through
+        static size_t readCounter(const volatile size_t &counter) {
+            size_t value;
+            do { value = counter; } while (value != counter);
+            return value;
+        }
+};
+
+// holds the start of a line that was cut off at the end of a chunk given to `CommandParser<...>::processChunk`, until the chunk with the rest of it arrives
+// `processChunk` only runs lines of up to SIZE - 1 characters, wherever they fall in the chunks, so that how the input is split up never changes the result
+template<size_t SIZE> class CommandLineBuffer {
+    static_assert(SIZE >= 2, "CommandLineBuffer SIZE must be at least 2");
+    public:
+        static const size_t CAPACITY = SIZE - 1;
+
+        size_t length() const { return used; } // characters of the line so far, including any that didn't fit
+        void append(const char *data, size_t length) {
+            if (used < CAPACITY) { memcpy(line + used, data, length < CAPACITY - used ? length : CAPACITY - used); }
+            used += length;
+        }
+        char *finish() { // the whole line, null-terminated, if it fit
+            line[used < CAPACITY ? used : CAPACITY] = '\0';
+            return line;
+        }
+        void clear() { used = 0; }
+    private:
+        char line[SIZE];
+        size_t used = 0;
+};
+
+template<size_t COMMANDS = 16, size_t COMMAND_ARGS = 4, size_t COMMAND_NAME_LENGTH = 10, size_t COMMAND_ARG_SIZE = 32, size_t RESPONSE_SIZE = 64, typename LOOKUP = LinearCommandLookup, typename STORAGE = RamCommandStorage, size_t ARG_BUFFER_SIZE = (COMMAND_ARGS > 1 ? COMMAND_ARGS - 1 : 1) * (COMMAND_ARG_SIZE + 1), bool TYPED_COMMANDS = false>
+class CommandParser : private LOOKUP::template Index<COMMANDS, COMMAND_NAME_LENGTH> {
     public:
         static const size_t MAX_COMMANDS = COMMANDS;
         static const size_t MAX_COMMAND_ARGS = COMMAND_ARGS;
         static const size_t MAX_COMMAND_NAME_LENGTH = COMMAND_NAME_LENGTH;
         static const size_t MAX_COMMAND_ARG_SIZE = COMMAND_ARG_SIZE;
         static const size_t MAX_RESPONSE_SIZE = RESPONSE_SIZE;
+        static const size_t MAX_ARG_BUFFER_SIZE = ARG_BUFFER_SIZE;
+        static const bool HAS_TYPED_COMMANDS = TYPED_COMMANDS;
 
         union Argument {
             double asDouble;
             uint64_t asUInt64;
             int64_t asInt64;
-            char asString[MAX_COMMAND_ARG_SIZE + 1];
+            uint32_t asUInt32;
+            int32_t asInt32;
+            uint16_t asUInt16;
+            int16_t asInt16;
+            uint8_t asUInt8;
+            int8_t asInt8;
+            char *asString; // points into the parser's argument buffer, which is shared by all the string arguments of a command
+            CommandParserStringView asStringView;
+        };
+
+        typedef CommandParserStringView StringView;
+
+        typedef void (*Callback)(union Argument *args, char *response);
+
+        typedef CommandParserResponse Response;
+        typedef void (*ResponseCallback)(union Argument *args, Response &response);
+
+        // why a command couldn't be parsed; the message for each is given by `formatError`
+        enum ErrorCode : uint8_t {
+            ERROR_NONE,
+            ERROR_UNKNOWN_COMMAND,
+            ERROR_INVALID_DOUBLE,
+            ERROR_INVALID_UINT64,
+            ERROR_INVALID_INT64,
+            ERROR_INVALID_UINT32,
+            ERROR_INVALID_INT32,
+            ERROR_INVALID_UINT16,
+            ERROR_INVALID_INT16,
+            ERROR_INVALID_UINT8,
+            ERROR_INVALID_INT8,
+            ERROR_INVALID_STRING,
+            ERROR_MISSING_WHITESPACE,
+            ERROR_TOO_MANY_ARGS,
+            ERROR_NO_ROOM_FOR_STRING,
+            ERROR_INVALID_ARG_TYPE,
+            ERROR_COMMAND_TOO_LONG,
+        };
+
+        struct Error {
+            ErrorCode code;
+            typename CommandParserUInt<MAX_COMMAND_ARGS>::Type argument; // the argument number (starting at 1) that the error is about, or for `ERROR_TOO_MANY_ARGS`, how many arguments the command takes
+            size_t offset; // the byte offset within the command of the start of the offending argument (0 for `ERROR_UNKNOWN_COMMAND` and `ERROR_COMMAND_TOO_LONG`), or for `ERROR_MISSING_WHITESPACE` and `ERROR_TOO_MANY_ARGS`, of what was found instead of a separator or the end
+        };
+
+        // a command as it would be passed to `registerCommand`, for building command tables at compile time
+        // the constructor validates the command and measures and hashes its name, so a `constexpr` array of these needs no work at startup
+        // invalid command definitions stop compilation with an error mentioning one of the `commandDefinition*` functions declared below (or, if the array is not declared `constexpr`, fail to link)
+        struct CommandDefinition {
+            const char *name;
+            const char *argTypes;
+            Callback callback;
+            typename CommandParserUInt<MAX_COMMAND_NAME_LENGTH>::Type nameLength;
+            uint16_t nameHash;
+
+            constexpr CommandDefinition(const char *name, const char *argTypes, Callback callback) :
+                name(name), argTypes(checkedArgTypes(argTypes)), callback(checkedCallback(callback)), nameLength(checkedNameLength(name)), nameHash(hashName(name)) {}
+        };
+
+        // the smallest `ARG_BUFFER_SIZE` that the string arguments of `commands` need, for checking at compile time that a parser which only dispatches a command table doesn't set aside more than that, as in
+        // `static_assert(MyCommandParser::argBufferSizeFor(commands) == MyCommandParser::MAX_ARG_BUFFER_SIZE, "ARG_BUFFER_SIZE doesn't match the command table");`
+        template<size_t N> static constexpr size_t argBufferSizeFor(const CommandDefinition (&commands)[N], size_t position = 0, size_t largest = 0) {
+            return position == N ? largest : argBufferSizeFor(commands, position + 1, argBufferNeeded(commands[position].argTypes) > largest ? argBufferNeeded(commands[position].argTypes) : largest);
+        }
+
+#if __cplusplus >= 201402L
+        // a read-only command table with a minimal perfect hash over the command names, meant to be built at compile time with `makePerfectHashTable` and stored in PROGMEM
+        // lookup takes one hash of the input name to pick a bucket, one seed read and a seeded hash of the name to pick the slot, and one name comparison
+        template<size_t N> struct PerfectHashTable {
+            static_assert(N > 0, "a command table needs at least one command");
+            static const size_t SIZE = N;
+            static const size_t BUCKETS = commandParserPowerOfTwo((N + 3) / 4); // names are first hashed into buckets of about 4 names each, then each bucket gets its own seed
+
+            uint16_t seeds[BUCKETS];
+            char names[N][MAX_COMMAND_NAME_LENGTH + 1];
+            char argTypes[N][MAX_COMMAND_ARGS + 1];
+            Callback callbacks[N];
+
+            constexpr PerfectHashTable() : seeds(), names(), argTypes(), callbacks() {}
         };
+
+        // builds a perfect hash table for `commands` at compile time, typically used like `constexpr auto table PROGMEM = MyCommandParser::makePerfectHashTable(commands);`
+        // duplicate names stop compilation with an error mentioning one of the `perfectHashTable*` functions declared below (or, if the table is not declared `constexpr`, fail to link)
+        template<size_t N> static constexpr PerfectHashTable<N> makePerfectHashTable(const CommandDefinition (&commands)[N]) {
+            PerfectHashTable<N> table;
+            const size_t BUCKETS = PerfectHashTable<N>::BUCKETS;
+
+            // the commands were already validated and hashed when they were constructed, so just check for duplicates and sort the names into buckets
+            // names whose hashes collide land in the same bucket, but are still separated by the seeded hash of their bytes, so only names that are actually equal are rejected
+            size_t buckets[N] = {};
+            size_t bucketSizes[BUCKETS] = {};
+            for (size_t i = 0; i < N; i ++) {
+                for (size_t j = 0; j < i; j ++) {
+                    if (commands[i].nameHash == commands[j].nameHash && commands[i].nameLength == commands[j].nameLength && sameName(commands[i].name, commands[j].name)) { perfectHashTableDuplicateName(); }
+                }
+                buckets[i] = commandNameHashMix(commands[i].nameHash, 0) & (BUCKETS - 1);
+                bucketSizes[buckets[i]] ++;
+            }
+
+            // place the largest buckets first, while the table is still mostly empty, trying seeds until every name in the bucket lands in a distinct free slot
+            bool slotUsed[N] = {};
+            size_t slots[N] = {};
+            for (size_t bucketSize = N; bucketSize > 0; bucketSize --) {
+                for (size_t bucket = 0; bucket < BUCKETS; bucket ++) {
+                    if (bucketSizes[bucket] != bucketSize) { continue; }
+                    uint16_t seed = 1;
+                    while (true) {
+                        bool seedWorks = true;
+                        for (size_t i = 0; i < N && seedWorks; i ++) {
+                            if (buckets[i] != bucket) { continue; }
+                            slots[i] = seededNameHash(commands[i].name, commands[i].nameLength, seed) % N;
+                            if (slotUsed[slots[i]]) { seedWorks = false; }
+                            for (size_t j = 0; j < i && seedWorks; j ++) {
+                                if (buckets[j] == bucket && slots[j] == slots[i]) { seedWorks = false; }
+                            }
+                        }
+                        if (seedWorks) { break; }
+                        if (seed == 0xFFFF) { perfectHashTableNoSeedFound(); }
+                        seed ++;
+                    }
+                    table.seeds[bucket] = seed;
+                    for (size_t i = 0; i < N; i ++) {
+                        if (buckets[i] != bucket) { continue; }
+                        size_t slot = slots[i];
+                        slotUsed[slot] = true;
+                        for (size_t j = 0; commands[i].name[j] != '\0'; j ++) { table.names[slot][j] = commands[i].name[j]; }
+                        for (size_t j = 0; commands[i].argTypes[j] != '\0'; j ++) { table.argTypes[slot][j] = commands[i].argTypes[j]; }
+                        table.callbacks[slot] = commands[i].callback;
+                    }
+                }
+            }
+            return table;
+        }
+#endif
+
+        CommandParser() {}
+
+        // dispatch the commands in `commands` (which must outlive the parser, and is typically a `constexpr` array) in addition to any commands registered with `registerCommand`
+        // lookup compares against each command in turn, using the name lengths and hashes computed at compile time to skip most name comparisons
+        template<size_t N> CommandParser(const CommandDefinition (&commands)[N]) : commandTable(commands), commandTableLookup(&lookupCommandDefinitions<N>) {}
+
+#if __cplusplus >= 201402L
+        // dispatch the commands in `table` (which may be in PROGMEM, and must outlive the parser) in addition to any commands registered with `registerCommand`
+        template<size_t N> CommandParser(const PerfectHashTable<N> &table) : commandTable(&table), commandTableLookup(&lookupPerfectHashTable<N>) {}
+#endif
     private:
-        struct Command {
-            char name[MAX_COMMAND_NAME_LENGTH + 1];
-            char argTypes[MAX_COMMAND_ARGS + 1];
-            void (*callback)(union Argument *args, char *response);
+        template<size_t, size_t, size_t, size_t, size_t, typename, typename, size_t, bool> friend class StreamingCommandParser;
+
+        // a registered command's callback, along with a function that parses the command's arguments and calls the callback, or `nullptr` to parse them according to the command's argument types
+        // `invokeWithResponse` is the exception: the arguments are parsed according to the argument types first, and it only calls the callback
+        // without `TYPED_COMMANDS`, the function is always `nullptr`, so it isn't stored, and each command only takes one function pointer
+        typedef bool (*Invoker)(CommandParser &parser, Callback callback, const char *command, char *response);
+        template<bool HAS_INVOKER, typename = void> struct HandlerOf {
+            Callback callback;
+            Invoker invoke;
+            static HandlerOf make(Callback callback, Invoker invoke) { HandlerOf handler = {callback, invoke}; return handler; }
+        };
+        template<typename UNUSED> struct HandlerOf<false, UNUSED> {
+            Callback callback;
+            static constexpr Invoker invoke = nullptr;
+            static HandlerOf make(Callback callback, Invoker) { HandlerOf handler = {callback}; return handler; }
         };
+        typedef HandlerOf<TYPED_COMMANDS> Handler;
+        typedef typename STORAGE::template Table<COMMANDS, COMMAND_ARGS, COMMAND_NAME_LENGTH, Handler> CommandTable;
 
         union Argument commandArgs[MAX_COMMAND_ARGS];
-        struct Command commandDefinitions[MAX_COMMANDS];
-        size_t numCommands = 0;
+        Response *currentResponse = nullptr; // where callbacks taking a `Response` write, or `nullptr` to write into the response buffer
+        Error error = {ERROR_NONE, 0, 0}; // why the last command failed
+        const char *commandStart = nullptr; // the command being processed, which error offsets are relative to
+        const char *errorName = nullptr; // the name of the last unknown command, pointing into the command or the streaming parser's copy of it
+        size_t errorNameLength = 0;
+        char argBuffer[MAX_ARG_BUFFER_SIZE > 0 ? MAX_ARG_BUFFER_SIZE : 1]; // decoded string arguments, packed one after another
+        typename CommandParserUInt<MAX_ARG_BUFFER_SIZE>::Type argBufferUsed = 0;
+        typename CommandParserUInt<MAX_ARG_BUFFER_SIZE>::Type argBufferReserved = 0; // space set aside for the string arguments of the current command that haven't been parsed yet
+        bool inPlace = false; // whether the current command may be modified to decode string arguments, rather than using `argBuffer`
+        bool separatorConsumed = false; // whether the whitespace after the last argument was overwritten with its null terminator, when parsing in place
+        CommandTable commandDefinitions;
+        typedef typename LOOKUP::template Index<COMMANDS, COMMAND_NAME_LENGTH> CommandLookup;
+
+        // an optional read-only command table that is searched before the registered commands, along with the function that searches it
+        // on a match, the lookup function copies the command's argument types into `argTypes` (a buffer of `MAX_COMMAND_ARGS + 1` bytes) and sets `callback`
+        const void *commandTable = nullptr;
+        bool (*commandTableLookup)(const void *table, const char *name, size_t nameLength, uint16_t hash, char *argTypes, Callback *callback) = nullptr;
+
+        template<size_t N> static bool lookupCommandDefinitions(const void *table, const char *name, size_t nameLength, uint16_t hash, char *argTypes, Callback *callback) {
+            const CommandDefinition *commands = (const CommandDefinition *)table;
+            for (size_t i = 0; i < N; i ++) {
+                if (commands[i].nameHash == hash && commands[i].nameLength == nameLength && memcmp(commands[i].name, name, nameLength) == 0) {
+                    strlcpy(argTypes, commands[i].argTypes, MAX_COMMAND_ARGS + 1);
+                    *callback = commands[i].callback;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static constexpr bool isValidArgType(char argType) {
+            return argType == 'd' || argType == 'u' || argType == 'i' || argType == 'L' || argType == 'l' || argType == 'H' || argType == 'h' || argType == 'B' || argType == 'b' || argType == 's' || argType == 'v';
+        }
+        static constexpr bool areValidArgTypes() { return true; }
+        template<typename... REST> static constexpr bool areValidArgTypes(char argType, REST... rest) {
+            return isValidArgType(argType) && areValidArgTypes(rest...);
+        }
+
+        // the most space that arguments of these types can take up in `argBuffer`; string views don't count, since they only use space that isn't needed for strings
+        // with an `ARG_BUFFER_SIZE` of 0, nothing is set aside, and string arguments can only be parsed in place
+        static constexpr size_t argBufferNeeded(char argType) { return argType == 's' && MAX_ARG_BUFFER_SIZE > 0 ? MAX_COMMAND_ARG_SIZE + 1 : 0; }
+        static constexpr size_t argBufferNeeded(const char *argTypes) { return *argTypes == '\0' ? 0 : argBufferNeeded(*argTypes) + argBufferNeeded(argTypes + 1); }
+        static constexpr size_t totalArgBufferNeeded() { return 0; }
+        template<typename... REST> static constexpr size_t totalArgBufferNeeded(char argType, REST... rest) { return argBufferNeeded(argType) + totalArgBufferNeeded(rest...); }
+        template<typename... ARGS> static constexpr size_t totalArgBufferNeeded(CommandParserTypeList<ARGS...>) { return totalArgBufferNeeded(CommandParserArgTypeOf<ARGS>::VALUE...); }
+
+        // these are intentionally never defined: the `CommandDefinition` constructor calls them to report invalid command definitions as compile errors
+        static void commandDefinitionNameTooLong();
+        static void commandDefinitionInvalidArgType();
+        static void commandDefinitionTooManyArgs();
+        static void commandDefinitionMissingCallback();
+        static void commandDefinitionArgBufferTooSmall();
+
+        // these are written as single return statements, since the constructor must be `constexpr` in C++11
+        static constexpr size_t checkedNameLength(const char *name, size_t length = 0) {
+            return name[length] != '\0' ? checkedNameLength(name, length + 1) : length > MAX_COMMAND_NAME_LENGTH ? (commandDefinitionNameTooLong(), length) : length;
+        }
+        static constexpr const char *checkedArgTypes(const char *argTypes, size_t position = 0) {
+            return argTypes[position] == '\0' ? (position > MAX_COMMAND_ARGS ? (commandDefinitionTooManyArgs(), argTypes) : argBufferNeeded(argTypes) > MAX_ARG_BUFFER_SIZE ? (commandDefinitionArgBufferTooSmall(), argTypes) : argTypes) :
+                   isValidArgType(argTypes[position]) ? checkedArgTypes(argTypes, position + 1) : (commandDefinitionInvalidArgType(), argTypes);
+        }
+        static constexpr Callback checkedCallback(Callback callback) {
+            return callback == nullptr ? (commandDefinitionMissingCallback(), callback) : callback;
+        }
+        static constexpr uint16_t hashName(const char *name, uint16_t hash = COMMAND_NAME_HASH_SEED) {
+            return *name == '\0' ? hash : hashName(name + 1, commandNameHashStep(hash, *name));
+        }
+
+#if __cplusplus >= 201402L
+        template<size_t N> static bool lookupPerfectHashTable(const void *table, const char *name, size_t nameLength, uint16_t hash, char *argTypes, Callback *callback) {
+            const PerfectHashTable<N> *perfectHashTable = (const PerfectHashTable<N> *)table;
+            uint16_t seed = pgm_read_word(&perfectHashTable->seeds[commandNameHashMix(hash, 0) & (PerfectHashTable<N>::BUCKETS - 1)]);
+            size_t slot = seededNameHash(name, nameLength, seed) % N;
+            if (nameLength > MAX_COMMAND_NAME_LENGTH || pgm_read_byte(&perfectHashTable->names[slot][nameLength]) != '\0' || memcmp_P(name, perfectHashTable->names[slot], nameLength) != 0) { return false; }
+            memcpy_P(argTypes, perfectHashTable->argTypes[slot], MAX_COMMAND_ARGS + 1);
+            *callback = (Callback)pgm_read_ptr(&perfectHashTable->callbacks[slot]);
+            return true;
+        }
+
+        // hashes the `length` bytes at `name` with a bucket's seed, picking the name's slot in a perfect hash table
+        // unlike the name hash that picks the bucket, this depends on the seed at every byte, so names whose name hashes collide still get different slots for most seeds
+        static constexpr uint16_t seededNameHash(const char *name, size_t length, uint16_t seed) {
+            uint16_t hash = seed;
+            for (size_t i = 0; i < length; i ++) { hash = commandNameHashMix((uint16_t)(hash ^ (uint8_t)name[i]), seed); }
+            return hash;
+        }
+        static constexpr bool sameName(const char *a, const char *b) {
+            for (; *a != '\0'; a ++, b ++) {
+                if (*a != *b) { return false; }
+            }
+            return *b == '\0';
+        }
+
+        // these are intentionally never defined: `makePerfectHashTable` calls them to report invalid command tables as compile errors
+        static void perfectHashTableDuplicateName();
+        static void perfectHashTableNoSeedFound();
+#endif
 
-        size_t parseString(const char *buf, char *output) {
+        static uint16_t hashCommandName(const char *name, size_t length) {
+            uint16_t hash = COMMAND_NAME_HASH_SEED;
+            for (size_t i = 0; i < length; i ++) { hash = commandNameHashStep(hash, name[i]); }
+            return hash;
+        }
+
+        // decodes the string at `buf` into `output`, which must have room for `maxLength` characters plus a null terminator, setting `outputLength` to the number of characters decoded
+        // a string with more than `maxLength` characters is cut short if unquoted and fails if quoted, unless `tooLong` is given, in which case it always fails and sets `*tooLong`
+        size_t parseString(const char *buf, char *output, size_t maxLength, size_t &outputLength, bool *tooLong = nullptr) {
             size_t readCount = 0;
             bool isQuoted = buf[0] == '"'; // whether the string is quoted or just a plain word
             if (isQuoted) {
@@ -105,7 +1149,7 @@ class CommandParser {
             }
 
             size_t i = 0;
-            for (; i < MAX_COMMAND_ARG_SIZE && buf[readCount] != '\0'; i ++) { // loop through each character of the string literal
+            for (; i < maxLength && buf[readCount] != '\0'; i ++) { // loop through each character of the string literal
                 if (isQuoted ? buf[readCount] == '"' : buf[readCount] == ' ') {
                     break;
                 }
@@ -136,129 +1180,970 @@ class CommandParser {
                     readCount ++;
                 }
             }
+            if (tooLong != nullptr && buf[readCount] != '\0' && buf[readCount] != (isQuoted ? '"' : ' ')) {
+                *tooLong = true;
+                return 0;
+            }
             if (isQuoted) {
                 if (buf[readCount] != '"') { return 0; }
                 readCount ++; // move past the closing quote
             }
 
             output[i] = '\0';
+            outputLength = i;
             return readCount;
         }
-    public:
-        bool registerCommand(const char *name, const char *argTypes, void (*callback)(union Argument *args, char *response)) {
-            if (numCommands == MAX_COMMANDS) { return false; }
-            if (strlen(name) > MAX_COMMAND_NAME_LENGTH) { return false; }
+
+        // require and skip 1 or more whitespace characters before the argument at `index`
+        bool skipArgumentSeparator(size_t index, const char *&command) {
+            if (*command != ' ' && !separatorConsumed) { return fail(ERROR_MISSING_WHITESPACE, index + 1, command); }
+            separatorConsumed = false;
+            while (*command == ' ') { command ++; }
+            return true;
+        }
+
+        // skip trailing whitespace, and ensure that we're at the end of the command
+        bool checkEndOfArguments(size_t numArgs, const char *command) {
+            while (*command == ' ') { command ++; }
+            if (*command != '\0') { return fail(ERROR_TOO_MANY_ARGS, numArgs, command); }
+            return true;
+        }
+
+        // each of these parses the argument at `index` into `value`, and moves `command` past it
+        bool parseValue(size_t index, const char *&command, double &value) {
+            size_t bytesRead = strToDouble(command, &value);
+            if (bytesRead == 0 || (command[bytesRead] != ' ' && command[bytesRead] != '\0')) { return fail(ERROR_INVALID_DOUBLE, index + 1, command); }
+            command += bytesRead;
+            return true;
+        }
+        bool parseValue(size_t index, const char *&command, uint64_t &value) { return parseInteger<uint64_t>(index, command, value, 0, ULONG_LONG_MAX, ERROR_INVALID_UINT64); }
+        bool parseValue(size_t index, const char *&command, int64_t &value) { return parseInteger<int64_t>(index, command, value, LONG_LONG_MIN, LONG_LONG_MAX, ERROR_INVALID_INT64); }
+        bool parseValue(size_t index, const char *&command, uint32_t &value) { return parseInteger<uint32_t>(index, command, value, 0, 4294967295UL, ERROR_INVALID_UINT32); }
+        bool parseValue(size_t index, const char *&command, int32_t &value) { return parseInteger<int32_t>(index, command, value, -2147483647L - 1, 2147483647L, ERROR_INVALID_INT32); }
+        bool parseValue(size_t index, const char *&command, uint16_t &value) { return parseInteger<uint16_t>(index, command, value, 0, 65535U, ERROR_INVALID_UINT16); }
+        bool parseValue(size_t index, const char *&command, int16_t &value) { return parseInteger<int16_t>(index, command, value, -32768, 32767, ERROR_INVALID_INT16); }
+        bool parseValue(size_t index, const char *&command, uint8_t &value) { return parseInteger<uint8_t>(index, command, value, 0, 255, ERROR_INVALID_UINT8); }
+        bool parseValue(size_t index, const char *&command, int8_t &value) { return parseInteger<int8_t>(index, command, value, -128, 127, ERROR_INVALID_INT8); }
+        // integers are parsed at their own width, so narrow ones never need 64-bit arithmetic
+        template<typename T> bool parseInteger(size_t index, const char *&command, T &value, T minValue, T maxValue, ErrorCode code) {
+            size_t bytesRead = strToInt<T>(command, &value, minValue, maxValue);
+            if (bytesRead == 0 || (command[bytesRead] != ' ' && command[bytesRead] != '\0')) { return fail(code, index + 1, command); }
+            command += bytesRead;
+            return true;
+        }
+        // if the string at `command` is a plain word or a quoted string without escape sequences, sets `start` and `end` to the bounds of its contents and returns `true`
+        static bool findPlainString(const char *command, const char *&start, const char *&end) {
+            bool isQuoted = *command == '"';
+            start = end = command + isQuoted;
+            while (*end != '\0' && *end != '\\' && (isQuoted ? *end != '"' : *end != ' ')) { end ++; }
+            return isQuoted ? *end == '"' : *end != '\\' && end != start;
+        }
+
+        bool parseValue(size_t index, const char *&command, char *&value) {
+            argBufferReserved -= argBufferNeeded('s');
+            size_t length, readCount;
+            if (inPlace) { // the string is decoded over itself, which never writes past the characters already read, and can be as long as the command
+                const char *start, *end;
+                if (findPlainString(command, start, end)) { // just terminate it where it is, moving past the separator if that's what gets overwritten
+                    value = const_cast<char *>(start);
+                    separatorConsumed = *end == ' ';
+                    command = end + (*end != '\0');
+                    value[end - start] = '\0';
+                    return true;
+                }
+                value = const_cast<char *>(command);
+                readCount = parseString(command, value, (size_t)-1, length); // escape sequences shorten the string, so the terminator is always written before the separator
+            } else { // the string is decoded into the free space in `argBuffer`, where it stays until the callback returns
+                if (MAX_ARG_BUFFER_SIZE == 0) { return fail(ERROR_NO_ROOM_FOR_STRING, index + 1, command); }
+                value = &argBuffer[argBufferUsed];
+                readCount = parseString(command, value, MAX_COMMAND_ARG_SIZE, length);
+            }
+            if (readCount == 0) { return fail(ERROR_INVALID_STRING, index + 1, command); }
+            if (!inPlace) { argBufferUsed += length + 1; } // `length` is only set when the string parsed
+            command += readCount;
+            return true;
+        }
+        bool parseValue(size_t index, const char *&command, StringView &value) {
+            // plain words and quoted strings without escape sequences are passed through as they appear in the command
+            const char *start, *end;
+            if (findPlainString(command, start, end)) {
+                value.ptr = start;
+                value.len = end - start;
+                command = end + (*end == '"');
+                return true;
+            }
+
+            // anything else is decoded, either over itself when parsing in place, or into whatever space in `argBuffer` isn't set aside for string arguments
+            size_t available = inPlace ? (size_t)-1 : MAX_ARG_BUFFER_SIZE - argBufferUsed - argBufferReserved;
+            char *string = inPlace ? const_cast<char *>(command) : &argBuffer[argBufferUsed];
+            bool tooLong = available == 0;
+            size_t readCount = tooLong ? 0 : parseString(command, string, available - 1, value.len, &tooLong);
+            if (readCount == 0) { return fail(tooLong ? ERROR_NO_ROOM_FOR_STRING : ERROR_INVALID_STRING, index + 1, command); }
+            value.ptr = string;
+            if (!inPlace) { argBufferUsed += value.len + 1; }
+            command += readCount;
+            return true;
+        }
+        bool parseValue(size_t index, const char *&command, const char *&value) {
+            char *string;
+            if (!parseValue(index, command, string)) { return false; }
+            value = string;
+            return true;
+        }
+
+        // each of these parses the argument at `index`, of the type given by the tag, into `commandArgs[index]`, and moves `command` past it
+        bool parseArgument(CommandParserArgType<'d'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asDouble); }
+        bool parseArgument(CommandParserArgType<'u'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asUInt64); }
+        bool parseArgument(CommandParserArgType<'i'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asInt64); }
+        bool parseArgument(CommandParserArgType<'L'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asUInt32); }
+        bool parseArgument(CommandParserArgType<'l'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asInt32); }
+        bool parseArgument(CommandParserArgType<'H'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asUInt16); }
+        bool parseArgument(CommandParserArgType<'h'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asInt16); }
+        bool parseArgument(CommandParserArgType<'B'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asUInt8); }
+        bool parseArgument(CommandParserArgType<'b'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asInt8); }
+        bool parseArgument(CommandParserArgType<'s'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asString); }
+        bool parseArgument(CommandParserArgType<'v'>, size_t index, const char *&command) { return parseValue(index, command, commandArgs[index].asStringView); }
+
+        // parses the arguments starting at `INDEX` with one call per argument type, so each signature gets straight-line code with no per-argument dispatch
+        template<size_t INDEX> bool parseArguments(const char *&) { return true; }
+        template<size_t INDEX, char ARG_TYPE, char... REST> bool parseArguments(const char *&command) {
+            return skipArgumentSeparator(INDEX, command) && parseArgument(CommandParserArgType<ARG_TYPE>(), INDEX, command) && parseArguments<INDEX + 1, REST...>(command);
+        }
+
+        // `invoke` functions for registered commands: these parse the arguments in `command` and call `callback`, or if `command` is `nullptr`, call it with the arguments already in `commandArgs`
+        template<char... ARG_TYPES> static bool invokeWithArgTypes(CommandParser &parser, Callback callback, const char *command, char *response) {
+            parser.argBufferReserved = totalArgBufferNeeded(ARG_TYPES...);
+            if (command != nullptr && (!parser.parseArguments<0, ARG_TYPES...>(command) || !parser.checkEndOfArguments(sizeof...(ARG_TYPES), command))) { return false; }
+            response[0] = '\0';
+            (*callback)(parser.commandArgs, response);
+            return true;
+        }
+
+        // calls a `ResponseCallback` with the arguments already parsed into `commandArgs`, according to the command's argument types
+        static bool invokeWithResponse(CommandParser &parser, Callback callback, const char *, char *response) {
+            (*castCallback<ResponseCallback>(callback))(parser.commandArgs, ResponseArgument(parser.currentResponse, response));
+            return true;
+        }
+
+        // the last argument passed to callbacks, which becomes the response buffer for those that take a `char *`, or a `Response` for those that take one
+        class ResponseArgument {
+            public:
+                ResponseArgument(Response *target, char *buffer) : target(target), buffer(buffer), local(buffer, MAX_RESPONSE_SIZE) {}
+                operator char *() const { return buffer; }
+                operator Response &() const { return target != nullptr ? *target : local; }
+            private:
+                Response *target;
+                char *buffer;
+                mutable Response local; // writes into `buffer`, when no `Response` was given to `processCommand`
+        };
+
+        // parses the arguments of types `NEXT, REST...` starting at `INDEX`, each into a local that is passed on to parse the next, then calls `callback` with all of them
+        template<size_t INDEX, typename FUNCTION, typename... VALUES> bool parseTypedArguments(CommandParserTypeList<>, FUNCTION callback, const char *command, char *response, VALUES... values) {
+            if (!checkEndOfArguments(INDEX, command)) { return false; }
+            response[0] = '\0';
+            (*callback)(values..., ResponseArgument(currentResponse, response));
+            return true;
+        }
+        template<size_t INDEX, typename FUNCTION, typename NEXT, typename... REST, typename... VALUES> bool parseTypedArguments(CommandParserTypeList<NEXT, REST...>, FUNCTION callback, const char *command, char *response, VALUES... values) {
+            NEXT value;
+            if (!skipArgumentSeparator(INDEX, command) || !parseValue(INDEX, command, value)) { return false; }
+            return parseTypedArguments<INDEX + 1>(CommandParserTypeList<REST...>(), callback, command, response, values..., value);
+        }
+
+        // converts `callback` to another function pointer type through `void (*)()`, which can be cast to and from any of them without -Wcast-function-type warnings; it must be converted back before being called
+        template<typename TO, typename FROM> static TO castCallback(FROM callback) { return reinterpret_cast<TO>(reinterpret_cast<void (*)()>(callback)); }
+
+        template<typename... PARAMS> static bool invokeTyped(CommandParser &parser, Callback callback, const char *command, char *response) {
+            typedef typename CommandParserSignature<CommandParserTypeList<>, PARAMS...>::Args Args;
+            parser.argBufferReserved = totalArgBufferNeeded(Args());
+            if (command == nullptr) { return parser.callTypedWithArguments<0>(Args(), castCallback<void (*)(PARAMS...)>(callback), response); }
+            return parser.parseTypedArguments<0>(Args(), castCallback<void (*)(PARAMS...)>(callback), command, response);
+        }
+
+        // calls `callback` with the values in `commandArgs`, converted to the types `NEXT, REST...` starting at `INDEX`
+        template<size_t INDEX, typename FUNCTION, typename... VALUES> bool callTypedWithArguments(CommandParserTypeList<>, FUNCTION callback, char *response, VALUES... values) {
+            response[0] = '\0';
+            (*callback)(values..., ResponseArgument(currentResponse, response));
+            return true;
+        }
+        template<size_t INDEX, typename FUNCTION, typename NEXT, typename... REST, typename... VALUES> bool callTypedWithArguments(CommandParserTypeList<NEXT, REST...>, FUNCTION callback, char *response, VALUES... values) {
+            NEXT value;
+            getArgument(commandArgs[INDEX], value);
+            return callTypedWithArguments<INDEX + 1>(CommandParserTypeList<REST...>(), callback, response, values..., value);
+        }
+        static void getArgument(const Argument &argument, double &value) { value = argument.asDouble; }
+        static void getArgument(const Argument &argument, uint64_t &value) { value = argument.asUInt64; }
+        static void getArgument(const Argument &argument, int64_t &value) { value = argument.asInt64; }
+        static void getArgument(const Argument &argument, uint32_t &value) { value = argument.asUInt32; }
+        static void getArgument(const Argument &argument, int32_t &value) { value = argument.asInt32; }
+        static void getArgument(const Argument &argument, uint16_t &value) { value = argument.asUInt16; }
+        static void getArgument(const Argument &argument, int16_t &value) { value = argument.asInt16; }
+        static void getArgument(const Argument &argument, uint8_t &value) { value = argument.asUInt8; }
+        static void getArgument(const Argument &argument, int8_t &value) { value = argument.asInt8; }
+        static void getArgument(const Argument &argument, const char *&value) { value = argument.asString; }
+        static void getArgument(const Argument &argument, StringView &value) { value = argument.asStringView; }
+
+        template<typename... ARGS> bool registerTypedCommand(CommandParserTypeList<ARGS...>, const char *name, size_t nameLength, Handler handler) {
+            static_assert(sizeof...(ARGS) <= MAX_COMMAND_ARGS, "command has more than COMMAND_ARGS arguments");
+            static_assert(areValidArgTypes(CommandParserArgTypeOf<ARGS>::VALUE...), "command parameters must each be double, a fixed-width integer type from uint64_t/int64_t down to uint8_t/int8_t, const char *, or StringView");
+            static_assert(totalArgBufferNeeded(CommandParserTypeList<ARGS...>()) <= MAX_ARG_BUFFER_SIZE, "command's string parameters don't fit in ARG_BUFFER_SIZE");
+            static const char argTypes[] = {CommandParserArgTypeOf<ARGS>::VALUE..., '\0'};
+            return insertCommand(name, nameLength, argTypes, handler, nullptr, nullptr);
+        }
+
+        // registers a command with a name and argument types in RAM (or, if `flashName` and `flashArgTypes` aren't `nullptr`, copied from those strings in flash)
+        bool addCommand(const char *name, const char *argTypes, const Handler &handler, const char *flashName, const char *flashArgTypes) {
+            size_t nameLength = strlen(name);
+            if (nameLength > MAX_COMMAND_NAME_LENGTH) { return false; }
             if (strlen(argTypes) > MAX_COMMAND_ARGS) { return false; }
-            if (callback == nullptr) { return false; }
+            if (handler.callback == nullptr) { return false; }
             for (size_t i = 0; argTypes[i] != '\0'; i ++) {
-                switch (argTypes[i]) {
-                    case 'd':
-                    case 'u':
-                    case 'i':
-                    case 's':
-                        break;
-                    default:
-                        return false;
-                }
+                if (!isValidArgType(argTypes[i])) { return false; }
             }
+            if (argBufferNeeded(argTypes) > MAX_ARG_BUFFER_SIZE) { return false; }
+            return insertCommand(name, nameLength, argTypes, handler, flashName, flashArgTypes);
+        }
 
-            strlcpy(commandDefinitions[numCommands].name, name, MAX_COMMAND_NAME_LENGTH + 1);
-            strlcpy(commandDefinitions[numCommands].argTypes, argTypes, MAX_COMMAND_ARGS + 1);
-            commandDefinitions[numCommands].callback = callback;
-            numCommands ++;
+        // registers an already-validated command, failing only if there's no room for it
+        bool insertCommand(const char *name, size_t nameLength, const char *argTypes, const Handler &handler, const char *flashName, const char *flashArgTypes) {
+            if (commandDefinitions.size() == MAX_COMMANDS) { return false; }
+            size_t position = CommandLookup::insertPosition(commandDefinitions, name, nameLength);
+            uint16_t hash = hashCommandName(name, nameLength);
+            if (!commandDefinitions.insert(position, name, nameLength, hash, argTypes, handler, flashName, flashArgTypes)) { return false; }
+            CommandLookup::inserted(commandDefinitions, position, hash);
             return true;
         }
+    public:
+        bool registerCommand(const char *name, const char *argTypes, void (*callback)(union Argument *args, char *response)) {
+            static_assert(STORAGE::ACCEPTS_RAM_STRINGS, "this storage policy only keeps commands registered from flash, with F(...) or registerCommand_P");
+            Handler handler = Handler::make(callback, nullptr);
+            return addCommand(name, argTypes, handler, nullptr, nullptr);
+        }
+
+        // like `registerCommand`, but `callback` writes its response with a `Response`, which can stream it straight to its destination instead of filling a buffer
+        // only available with `TYPED_COMMANDS`, since the parser has to keep a function that calls `callback` with its real type
+        bool registerCommand(const char *name, const char *argTypes, ResponseCallback callback) {
+            static_assert(TYPED_COMMANDS, "commands whose callbacks take a Response can only be registered with TYPED_COMMANDS");
+            static_assert(STORAGE::ACCEPTS_RAM_STRINGS, "this storage policy only keeps commands registered from flash, with F(...) or registerCommand_P");
+            Handler handler = Handler::make(castCallback<Callback>(callback), &invokeWithResponse);
+            return addCommand(name, argTypes, handler, nullptr, nullptr);
+        }
+
+        // like `registerCommand`, but the argument types are given as template arguments, as in `registerCommand<'s', 'd', 'i', 'u'>("name", &callback)`
+        // the argument types, their count, and the name length (taken from the size of the literal) are checked with `static_assert`, so the only check left at runtime is whether there's room for another command
+        // with `TYPED_COMMANDS`, the command's arguments are parsed by code generated for its argument types, rather than by looping over them
+        // `callback` must not be `nullptr`
+        template<char... ARG_TYPES, size_t N> bool registerCommand(const char (&name)[N], Callback callback) {
+            static_assert(N - 1 <= MAX_COMMAND_NAME_LENGTH, "command name is longer than COMMAND_NAME_LENGTH");
+            static_assert(sizeof...(ARG_TYPES) <= MAX_COMMAND_ARGS, "command has more than COMMAND_ARGS arguments");
+            static_assert(areValidArgTypes(ARG_TYPES...), "command argument types must each be one of 'd', 'u', 'i', 'L', 'l', 'H', 'h', 'B', 'b', 's', or 'v'");
+            static_assert(totalArgBufferNeeded(ARG_TYPES...) <= MAX_ARG_BUFFER_SIZE, "command's string arguments don't fit in ARG_BUFFER_SIZE");
+            static_assert(STORAGE::ACCEPTS_RAM_STRINGS, "this storage policy only keeps commands registered from flash, with F(...) or registerCommand_P");
+            static const char argTypes[] = {ARG_TYPES..., '\0'};
+            Handler handler = Handler::make(callback, TYPED_COMMANDS ? &invokeWithArgTypes<ARG_TYPES...> : nullptr);
+            return insertCommand(name, N - 1, argTypes, handler, nullptr, nullptr);
+        }
+
+        // like `registerCommand`, but the argument types are taken from the parameters of `callback`, which receives the parsed values directly, as in `void callback(int64_t x, int64_t y, const char *s, char *response)`
+        // parameters may be `double`, `uint64_t`, `int64_t` (or the narrower `uint32_t`, `int32_t`, `uint16_t`, `int16_t`, `uint8_t`, and `int8_t`), `const char *` (a null-terminated string that is valid until the callback returns), or `StringView`, followed by the response buffer or a `Response &`
+        // the signature and name length are checked with `static_assert`, and `callback` must not be `nullptr`
+        // only available with `TYPED_COMMANDS`, like callbacks that take a `Response`
+        template<typename... PARAMS, size_t N> typename CommandParserEnableIf<!CommandParserIsSame<void (*)(PARAMS...), Callback>::VALUE, bool>::Type registerCommand(const char (&name)[N], void (*callback)(PARAMS...)) {
+            typedef CommandParserSignature<CommandParserTypeList<>, PARAMS...> Signature;
+            static_assert(N - 1 <= MAX_COMMAND_NAME_LENGTH, "command name is longer than COMMAND_NAME_LENGTH");
+            static_assert(CommandParserIsSame<typename Signature::Last, char *>::VALUE || CommandParserIsSame<typename Signature::Last, Response &>::VALUE, "the last parameter of a command callback must be the response buffer, a char *, or a Response &");
+            static_assert(TYPED_COMMANDS, "typed callbacks can only be registered with TYPED_COMMANDS");
+            static_assert(STORAGE::ACCEPTS_RAM_STRINGS, "this storage policy only keeps commands registered from flash, with F(...) or registerCommand_P");
+            Handler handler = Handler::make(castCallback<Callback>(callback), &invokeTyped<PARAMS...>);
+            return registerTypedCommand(typename Signature::Args(), name, N - 1, handler);
+        }
+
+        // like `registerCommand`, but `name` and `argTypes` are in flash (declared with `PROGMEM`)
+        bool registerCommand_P(const char *name, const char *argTypes, void (*callback)(union Argument *args, char *response)) {
+            // validation and lookup work on RAM copies, while the storage policy decides whether to keep the flash pointers or the copies
+            char nameBuffer[MAX_COMMAND_NAME_LENGTH + 1], argTypesBuffer[MAX_COMMAND_ARGS + 1];
+            size_t nameLength = strlen_P(name), argTypesLength = strlen_P(argTypes);
+            if (nameLength > MAX_COMMAND_NAME_LENGTH || argTypesLength > MAX_COMMAND_ARGS) { return false; }
+            memcpy_P(nameBuffer, name, nameLength + 1);
+            memcpy_P(argTypesBuffer, argTypes, argTypesLength + 1);
+            Handler handler = Handler::make(callback, nullptr);
+            return addCommand(nameBuffer, argTypesBuffer, handler, name, argTypes);
+        }
+
+        // like `registerCommand`, but `name` and `argTypes` are wrapped in `F(...)`
+        bool registerCommand(const __FlashStringHelper *name, const __FlashStringHelper *argTypes, void (*callback)(union Argument *args, char *response)) {
+            return registerCommand_P((const char *)name, (const char *)argTypes, callback);
+        }
 
         bool processCommand(const char *command, char *response) {
-            // retrieve the command name
-            char name[MAX_COMMAND_NAME_LENGTH + 1];
-            size_t i = 0;
-            for (; i < MAX_COMMAND_NAME_LENGTH && *command != ' ' && *command != '\0'; i ++, command ++) { name[i] = *command; }
-            name[i] = '\0';
-
-            // look up the command argument types and callback
-            char *argTypes = nullptr;
-            void (*callback)(union Argument *, char *) = nullptr;
-            for (size_t i = 0; i < numCommands; i ++) {
-                if (strcmp(commandDefinitions[i].name, name) == 0) {
-                    argTypes = commandDefinitions[i].argTypes;
-                    callback = commandDefinitions[i].callback;
+            inPlace = false;
+            if (dispatchCommand(command, response)) { return true; }
+            formatError(error, response, MAX_RESPONSE_SIZE);
+            return false;
+        }
+
+        // like `processCommand`, but if the command can't be parsed, `error` is set instead of formatting an error message into `response`, which is cheaper when bad input is expected to be common
+        bool processCommand(const char *command, char *response, Error &error) {
+            inPlace = false;
+            if (dispatchCommand(command, response)) { return true; }
+            error = this->error;
+            return false;
+        }
+
+        // like `processCommand`, but the response, or the error message, is written with `response`, which callbacks taking a `Response` write to directly
+        // callbacks taking a `char *` still write into a buffer of `MAX_RESPONSE_SIZE` bytes, which is then copied to `response`
+        bool processCommand(const char *command, Response &response) {
+            char buffer[MAX_RESPONSE_SIZE > 0 ? MAX_RESPONSE_SIZE : 1] = "";
+            inPlace = false;
+            currentResponse = &response;
+            bool processed = dispatchCommand(command, buffer);
+            currentResponse = nullptr;
+            if (processed) {
+                response.print(buffer);
+            } else {
+                formatError(error, response);
+            }
+            return processed;
+        }
+
+        // like `processCommand`, but string arguments are decoded and null-terminated inside `command` itself, the way `strtok` works, so `command` is modified
+        // this uses no space in the argument buffer, and string arguments may be as long as the command
+        bool processCommandInPlace(char *command, char *response) {
+            inPlace = true;
+            if (dispatchCommand(command, response)) { return true; }
+            formatError(error, response, MAX_RESPONSE_SIZE);
+            return false;
+        }
+        bool processCommandInPlace(char *command, char *response, Error &error) {
+            inPlace = true;
+            if (dispatchCommand(command, response)) { return true; }
+            error = this->error;
+            return false;
+        }
+
+        // writes the message for `error`, such as "parse error: invalid double for arg 2", built from templates in flash rather than with `snprintf`
+        // for `ERROR_UNKNOWN_COMMAND`, the name is read from the command that failed, so this must be called before that command's buffer is reused or the next byte is fed
+        size_t formatError(const Error &error, Response &output) const {
+            static const char prefix[] PROGMEM = "parse error: ";
+            static const char messages[] PROGMEM = // one for each error code, in order, with `#` standing for the argument number
+                "\0"
+                "unknown command name \0"
+                "invalid double for arg #\0"
+                "invalid uint64_t for arg #\0"
+                "invalid int64_t for arg #\0"
+                "invalid uint32_t for arg #\0"
+                "invalid int32_t for arg #\0"
+                "invalid uint16_t for arg #\0"
+                "invalid int16_t for arg #\0"
+                "invalid uint8_t for arg #\0"
+                "invalid int8_t for arg #\0"
+                "invalid string for arg #\0"
+                "missing whitespace before arg #\0"
+                "too many args (expected #)\0"
+                "no room for string arg #\0"
+                "invalid argtype for arg #\0"
+                "command too long";
+            if (error.code == ERROR_NONE) { return 0; }
+            const char *message = messages;
+            for (uint8_t i = 0; i < error.code; i ++) { message += strlen_P(message) + 1; }
+            size_t written = printErrorTemplate(output, prefix, 0) + printErrorTemplate(output, message, error.argument);
+            if (error.code == ERROR_UNKNOWN_COMMAND) { written += output.write(errorName, errorNameLength); }
+            return written;
+        }
+        size_t formatError(const Error &error, char *buffer, size_t size) const {
+            Response output(buffer, size);
+            return formatError(error, output);
+        }
+
+        struct PollResult {
+            size_t bytesConsumed;
+            size_t commandsDispatched; // commands whose callbacks were called
+        };
+
+        // processes a large block of input at once, such as a chunk read from a socket, printing the response to each command, or its error message, to `output` on its own line
+        // line ends are found with `memchr`, which the C library usually vectorizes, and each complete line is parsed in place with `processCommandInPlace`, so `data` is changed
+        // a partial line at the end is kept in `partial`, and finished in place there by the start of the next chunk; lines too long for `partial` fail with `ERROR_COMMAND_TOO_LONG`, even if they arrive whole
+        template<size_t LINE_SIZE, typename OUTPUT> PollResult processChunk(char *data, size_t length, CommandLineBuffer<LINE_SIZE> &partial, OUTPUT &output) {
+            PollResult result = {length, 0};
+            char response[MAX_RESPONSE_SIZE > 0 ? MAX_RESPONSE_SIZE : 1];
+            Response streamed(output); // callbacks taking a `Response` print straight to `output`
+            currentResponse = &streamed;
+            char *end = data + length;
+            while (data < end) {
+                char *lineEnd = (char *)memchr(data, '\n', end - data);
+                char *carriageReturn = (char *)memchr(data, '\r', (lineEnd == nullptr ? end : lineEnd) - data);
+                if (carriageReturn != nullptr) { lineEnd = carriageReturn; }
+                if (lineEnd == nullptr) { // the rest of the line is in a later chunk
+                    partial.append(data, end - data);
                     break;
                 }
+
+                char *line = data;
+                size_t lineLength = lineEnd - data;
+                *lineEnd = '\0';
+                if (partial.length() > 0) { // the line started in an earlier chunk
+                    partial.append(data, lineLength);
+                    line = partial.finish();
+                    lineLength = partial.length();
+                    partial.clear();
+                }
+                data = lineEnd + 1;
+                if (lineLength == 0) { continue; } // skip empty lines, such as the second half of "\r\n"
+                response[0] = '\0';
+                size_t streamedBefore = streamed.length();
+                if (lineLength > LINE_SIZE - 1) {
+                    error.code = ERROR_COMMAND_TOO_LONG;
+                    error.argument = 0;
+                    error.offset = 0;
+                    formatError(error, response, MAX_RESPONSE_SIZE);
+                } else if (processCommandInPlace(line, response)) {
+                    result.commandsDispatched ++;
+                }
+                if (response[0] != '\0' || streamed.length() != streamedBefore) { output.println(response); } // commands that printed nothing don't get a blank line
+            }
+            currentResponse = nullptr;
+            return result;
+        }
+    private:
+        // records why the command starting at `commandStart` couldn't be parsed, for `formatError`; always returns `false`
+        bool fail(ErrorCode code, size_t argument, const char *position) {
+            error.code = code;
+            error.argument = argument;
+            error.offset = position - commandStart;
+            return false;
+        }
+
+        static size_t printErrorTemplate(Response &output, const char *text, size_t argument) {
+            size_t written = 0;
+            for (char c; (c = pgm_read_byte(text)) != '\0'; text ++) {
+                written += c == '#' ? output.print((unsigned long)argument) : output.write(c);
             }
+            return written;
+        }
+
+        // looks up the command argument types and callback, first in the command table (if any), then in the registered commands
+        // returns the argument types (which may be copied into `argTypesBuffer`, a buffer of `MAX_COMMAND_ARGS + 1` bytes), or `nullptr` if there's no such command
+        const char *findCommand(const char *name, size_t nameLength, uint16_t hash, char *argTypesBuffer, Handler &handler) {
+            handler = Handler::make(nullptr, nullptr);
+            if (commandTable != nullptr && commandTableLookup(commandTable, name, nameLength, hash, argTypesBuffer, &handler.callback)) {
+                return argTypesBuffer;
+            }
+            size_t position = CommandLookup::find(commandDefinitions, name, nameLength, hash);
+            if (position == commandDefinitions.size()) { return nullptr; }
+            handler = commandDefinitions.handler(position);
+            return commandDefinitions.argTypes(position, argTypesBuffer);
+        }
+
+        bool dispatchCommand(const char *command, char *response) {
+            // find the end of the command name, hashing it along the way; the name is then matched in place rather than copied out
+            const char *name = command;
+            commandStart = command;
+            uint16_t hash = COMMAND_NAME_HASH_SEED;
+            for (; *command != ' ' && *command != '\0'; command ++) { hash = commandNameHashStep(hash, *command); }
+            size_t nameLength = command - name;
+
+            argBufferUsed = 0;
+            separatorConsumed = false;
+
+            Handler handler;
+            char tableArgTypes[MAX_COMMAND_ARGS + 1];
+            const char *argTypes = findCommand(name, nameLength, hash, tableArgTypes, handler);
             if (argTypes == nullptr) {
-                snprintf(response, MAX_RESPONSE_SIZE, "parse error: unknown command name %s", name);
-                return false;
+                errorName = name;
+                errorNameLength = nameLength;
+                return fail(ERROR_UNKNOWN_COMMAND, 0, name);
             }
+            if (handler.invoke != nullptr && handler.invoke != &invokeWithResponse) { return handler.invoke(*this, handler.callback, command, response); }
 
             // parse each command
+            argBufferReserved = argBufferNeeded(argTypes);
             for (size_t i = 0; argTypes[i] != '\0'; i ++) {
-                // require and skip 1 or more whitespace characters
-                if (*command != ' ') {
-                    snprintf(response, MAX_RESPONSE_SIZE, "parse error: missing whitespace before arg %d", i + 1);
+                if (!skipArgumentSeparator(i, command)) { return false; }
+                bool parsed;
+                switch (argTypes[i]) {
+                    case 'd': parsed = parseArgument(CommandParserArgType<'d'>(), i, command); break;
+                    case 'u': parsed = parseArgument(CommandParserArgType<'u'>(), i, command); break;
+                    case 'i': parsed = parseArgument(CommandParserArgType<'i'>(), i, command); break;
+                    case 'L': parsed = parseArgument(CommandParserArgType<'L'>(), i, command); break;
+                    case 'l': parsed = parseArgument(CommandParserArgType<'l'>(), i, command); break;
+                    case 'H': parsed = parseArgument(CommandParserArgType<'H'>(), i, command); break;
+                    case 'h': parsed = parseArgument(CommandParserArgType<'h'>(), i, command); break;
+                    case 'B': parsed = parseArgument(CommandParserArgType<'B'>(), i, command); break;
+                    case 'b': parsed = parseArgument(CommandParserArgType<'b'>(), i, command); break;
+                    case 's': parsed = parseArgument(CommandParserArgType<'s'>(), i, command); break;
+                    case 'v': parsed = parseArgument(CommandParserArgType<'v'>(), i, command); break;
+                    default: return fail(ERROR_INVALID_ARG_TYPE, i + 1, command);
+                }
+                if (!parsed) { return false; }
+            }
+            if (!checkEndOfArguments(strlen(argTypes), command)) { return false; }
+
+            // set response to empty string
+            response[0] = '\0';
+
+            // invoke the command
+            if (handler.invoke != nullptr) { return handler.invoke(*this, handler.callback, nullptr, response); }
+            (*handler.callback)(commandArgs, response);
+            return true;
+        }
+};
+
+
+// a `CommandParser` that can also parse commands a byte at a time as they arrive, with `feed`, `poll`, `drain`, and `processCommands`
+// the state that this needs to pick up parsing partway through a line is only kept by parsers of this type, so parsers that only use `processCommand` don't pay for it
+template<size_t COMMANDS = 16, size_t COMMAND_ARGS = 4, size_t COMMAND_NAME_LENGTH = 10, size_t COMMAND_ARG_SIZE = 32, size_t RESPONSE_SIZE = 64, typename LOOKUP = LinearCommandLookup, typename STORAGE = RamCommandStorage, size_t ARG_BUFFER_SIZE = (COMMAND_ARGS > 1 ? COMMAND_ARGS - 1 : 1) * (COMMAND_ARG_SIZE + 1), bool TYPED_COMMANDS = false>
+class StreamingCommandParser : public CommandParser<COMMANDS, COMMAND_ARGS, COMMAND_NAME_LENGTH, COMMAND_ARG_SIZE, RESPONSE_SIZE, LOOKUP, STORAGE, ARG_BUFFER_SIZE, TYPED_COMMANDS> {
+    typedef CommandParser<COMMANDS, COMMAND_ARGS, COMMAND_NAME_LENGTH, COMMAND_ARG_SIZE, RESPONSE_SIZE, LOOKUP, STORAGE, ARG_BUFFER_SIZE, TYPED_COMMANDS> Parser;
+    public:
+        using Parser::Parser;
+        using Parser::MAX_COMMAND_ARGS;
+        using Parser::MAX_COMMAND_NAME_LENGTH;
+        using Parser::MAX_COMMAND_ARG_SIZE;
+        using Parser::MAX_RESPONSE_SIZE;
+        using Parser::MAX_ARG_BUFFER_SIZE;
+        typedef typename Parser::Argument Argument;
+        typedef typename Parser::Response Response;
+        typedef typename Parser::Error Error;
+        typedef typename Parser::ErrorCode ErrorCode;
+        typedef typename Parser::PollResult PollResult;
+        using Parser::formatError;
+
+        // processes several commands separated by `separator` (or line breaks), such as `move 1 2; jump; say "a;b"`, running them in order and stopping at the first that fails
+        // separators inside quoted strings are part of the string, and whitespace before each command is ignored, as are empty commands
+        // the responses of the commands are joined with newlines in `response` (truncated to fit), ending with the error message if one failed
+        // returns `true` if every command was processed successfully; this uses the streaming parser, so it shouldn't be called while a command is partially fed
+        bool processCommands(const char *commands, char *response, char separator = ';') {
+            char commandResponse[MAX_RESPONSE_SIZE > 0 ? MAX_RESPONSE_SIZE : 1];
+            size_t responseLength = 0, finished = 0;
+            if (MAX_RESPONSE_SIZE > 0) { response[0] = '\0'; }
+            for (;; commands ++) {
+                char c = *commands;
+                if (c == ' ' && stream.state == STREAM_NAME && stream.length == 0) { continue; }
+                bool isCommandEnd = c == '\0' || (c == separator && !((stream.state == STREAM_STRING || stream.state == STREAM_STRING_ESCAPE || stream.state == STREAM_STRING_HEX) && stream.isQuoted));
+                FeedStatus status = feed(isCommandEnd ? '\n' : c, commandResponse);
+                if (status != FEED_PENDING && MAX_RESPONSE_SIZE > 0) {
+                    if (finished ++ > 0 && responseLength + 1 < MAX_RESPONSE_SIZE) { response[responseLength ++] = '\n'; }
+                    strlcpy(response + responseLength, commandResponse, MAX_RESPONSE_SIZE - responseLength);
+                    responseLength += strlen(response + responseLength);
+                }
+                if (status == FEED_FAILED) {
+                    resetStream(); // the rest of the commands are skipped, so don't leave the rest of this one to be discarded by later calls
                     return false;
                 }
-                do { command ++; } while (*command == ' ');
+                if (c == '\0') { return true; }
+            }
+        }
 
-                switch (argTypes[i]) {
-                    case 'd': { // double argument
-                        char *after;
-                        commandArgs[i].asDouble = strtod(command, &after);
-                        if (after == command || (*after != ' ' && *after != '\0')) {
-                            snprintf(response, MAX_RESPONSE_SIZE, "parse error: invalid double for arg %d", i + 1);
-                            return false;
-                        }
-                        command = after;
-                        break;
-                    }
-                    case 'u': { // uint64_t argument
-                        size_t bytesRead = strToInt<uint64_t>(command, &commandArgs[i].asUInt64, 0, ULONG_LONG_MAX);
-                        if (bytesRead == 0 || (command[bytesRead] != ' ' && command[bytesRead] != '\0')) {
-                            snprintf(response, MAX_RESPONSE_SIZE, "parse error: invalid uint64_t for arg %d", i + 1);
-                            return false;
-                        }
-                        command += bytesRead;
-                        break;
-                    }
-                    case 'i': { // int64_t argument
-                        size_t bytesRead = strToInt<int64_t>(command, &commandArgs[i].asInt64, LONG_LONG_MIN, LONG_LONG_MAX);
-                        if (bytesRead == 0 || (command[bytesRead] != ' ' && command[bytesRead] != '\0')) {
-                            snprintf(response, MAX_RESPONSE_SIZE, "parse error: invalid int64_t for arg %d", i + 1);
-                            return false;
-                        }
-                        command += bytesRead;
-                        break;
+        enum FeedStatus {
+            FEED_PENDING, // the command isn't finished yet
+            FEED_PROCESSED, // the command was finished and parsed successfully, and its callback was called
+            FEED_FAILED, // the command couldn't be parsed, and an error message was written to `response`; the rest of its line is ignored
+        };
+
+        // parses commands a byte at a time as they arrive, such as from a serial port, without ever buffering a whole line
+        // each line is a command, ending with `'\n'` or `'\r'` (empty lines are ignored), and the callback is called when its line ends; a `COMMAND_CANCEL_LINE` byte throws away the rest of its line
+        // commands are parsed the same way as with `processCommand`, except that double arguments can be up to 31 characters, string view arguments are always decoded into the argument buffer, and unknown command names are echoed back only up to `MAX_COMMAND_NAME_LENGTH` characters
+        // `processCommand` and `processCommandInPlace` shouldn't be called while a command is partially fed
+        FeedStatus feed(char c, char *response) {
+            FeedStatus status = feedByte(c, response);
+            if (status == FEED_FAILED) { formatError(error, response, MAX_RESPONSE_SIZE); }
+            return status;
+        }
+
+        // like `feed`, but if the command can't be parsed, `error` is set instead of formatting an error message into `response`
+        FeedStatus feed(char c, char *response, Error &error) {
+            FeedStatus status = feedByte(c, response);
+            if (status == FEED_FAILED) { error = this->error; }
+            return status;
+        }
+
+        // feeds up to `length` bytes from `buffer`, stopping early after any byte that finishes a command, so that its response can be handled
+        // returns the number of bytes consumed, and sets `status` to the result of feeding the last of them
+        size_t feed(const char *buffer, size_t length, char *response, FeedStatus *status) {
+            *status = FEED_PENDING;
+            for (size_t i = 0; i < length; i ++) {
+                *status = feed(buffer[i], response);
+                if (*status != FEED_PENDING) { return i + 1; }
+            }
+            return length;
+        }
+
+        // feeds only the bytes that `stream` (usually an Arduino `Stream` such as `Serial`) already has available, so it never waits for the rest of a line
+        // the response to each finished command, or its error message, is printed back to `stream` on its own line
+        template<typename STREAM> PollResult poll(STREAM &stream) { return pump(stream, stream); }
+
+        // feeds the bytes that an interrupt handler has pushed into `ring` so far, printing responses to `output` (such as `Serial`) like `poll` does
+        template<size_t SIZE, typename OUTPUT> PollResult drain(CommandRingBuffer<SIZE> &ring, OUTPUT &output) { return pump(ring, output); }
+
+    private:
+        typedef typename Parser::Handler Handler;
+        using Parser::ERROR_UNKNOWN_COMMAND;
+        using Parser::ERROR_INVALID_DOUBLE;
+        using Parser::ERROR_INVALID_UINT64;
+        using Parser::ERROR_INVALID_INT64;
+        using Parser::ERROR_INVALID_UINT32;
+        using Parser::ERROR_INVALID_INT32;
+        using Parser::ERROR_INVALID_UINT16;
+        using Parser::ERROR_INVALID_INT16;
+        using Parser::ERROR_INVALID_UINT8;
+        using Parser::ERROR_INVALID_INT8;
+        using Parser::ERROR_INVALID_STRING;
+        using Parser::ERROR_MISSING_WHITESPACE;
+        using Parser::ERROR_TOO_MANY_ARGS;
+        using Parser::ERROR_NO_ROOM_FOR_STRING;
+        using Parser::commandArgs;
+        using Parser::currentResponse;
+        using Parser::error;
+        using Parser::errorName;
+        using Parser::errorNameLength;
+        using Parser::argBuffer;
+        using Parser::argBufferUsed;
+        using Parser::argBufferReserved;
+        using Parser::argBufferNeeded;
+        using Parser::findCommand;
+
+        template<typename INPUT, typename OUTPUT> PollResult pump(INPUT &input, OUTPUT &output) {
+            PollResult result = {0, 0};
+            char response[MAX_RESPONSE_SIZE > 0 ? MAX_RESPONSE_SIZE : 1] = "";
+            Response streamed(output); // callbacks taking a `Response` print straight to `output`
+            currentResponse = &streamed;
+            size_t streamedBefore = 0;
+            for (int available = input.available(); available > 0; available --) {
+                int c = input.read();
+                if (c < 0) { break; }
+                result.bytesConsumed ++;
+                FeedStatus status = feed((char)c, response);
+                if (status == FEED_PENDING) { continue; }
+                if (status == FEED_PROCESSED) { result.commandsDispatched ++; }
+                if (response[0] != '\0' || streamed.length() != streamedBefore) { output.println(response); } // commands that printed nothing don't get a blank line
+                response[0] = '\0';
+                streamedBefore = streamed.length();
+            }
+            currentResponse = nullptr;
+            return result;
+        }
+
+        enum StreamState : uint8_t {
+            STREAM_NAME, // reading the command name
+            STREAM_SEPARATOR, // reading whitespace before an argument
+            STREAM_AFTER_ARGUMENT, // just after an argument that ended by itself with a closing quote
+            STREAM_INTEGER_SIGN, // at the start of an integer argument, where there may be a sign
+            STREAM_INTEGER_START, // after any sign, where there may be a leading zero
+            STREAM_INTEGER_PREFIX, // after a leading zero, where there may be a base identifier
+            STREAM_INTEGER_DIGITS, // reading the digits of an integer argument
+            STREAM_DOUBLE, // collecting a double argument in `stream.token`
+            STREAM_STRING_START, // at the start of a string argument, where there may be an opening quote
+            STREAM_STRING, // reading the characters of a string argument
+            STREAM_STRING_ESCAPE, // just after a backslash in a string argument
+            STREAM_STRING_HEX, // reading the digits of a hex escape in a string argument
+            STREAM_DISCARD, // skipping the rest of a line that couldn't be parsed
+        };
+        static const size_t STREAM_TOKEN_SIZE = MAX_COMMAND_NAME_LENGTH > 32 ? MAX_COMMAND_NAME_LENGTH : 32;
+
+        // everything `feed` needs to resume parsing where it left off
+        struct Stream {
+            StreamState state = STREAM_NAME;
+            bool isQuoted = false, isNegative, hasDigits;
+            uint8_t base, hexDigits;
+            uint16_t nameHash = COMMAND_NAME_HASH_SEED;
+            size_t length = 0; // characters read so far of the name, double, or string
+            size_t offset = 0; // offset of the current byte within the line
+            size_t argStart; // offset of the start of the current argument within the line
+            size_t maxLength; // the most characters the current string argument can have
+            size_t arg; // index of the current argument
+            char argTypes[MAX_COMMAND_ARGS + 1];
+            Handler handler;
+            char token[STREAM_TOKEN_SIZE]; // the command name, then each double argument
+        } stream;
+
+        // handles the next byte of input for `feed`, keeping track of its offset within the line
+        FeedStatus feedByte(char c, char *response) {
+            if (stream.state == STREAM_NAME && stream.length == 0) { stream.offset = 0; } // at the start of a line
+            FeedStatus status = stepStream(c, response);
+            stream.offset ++;
+            return status;
+        }
+
+        FeedStatus stepStream(char c, char *response) {
+            if (c == COMMAND_CANCEL_LINE) {
+                stream.state = STREAM_DISCARD;
+                return FEED_PENDING;
+            }
+            bool isLineEnd = c == '\n' || c == '\r';
+            switch (stream.state) {
+                case STREAM_DISCARD:
+                    if (isLineEnd) { resetStream(); }
+                    return FEED_PENDING;
+                case STREAM_NAME:
+                    if (c != ' ' && !isLineEnd) {
+                        if (stream.length == MAX_COMMAND_NAME_LENGTH) { return failUnknownStreamCommand(false); } // too long to be the name of any command
+                        stream.token[stream.length ++] = c;
+                        stream.nameHash = commandNameHashStep(stream.nameHash, c);
+                        return FEED_PENDING;
                     }
-                    case 's': {
-                        size_t readCount = parseString(command, commandArgs[i].asString);
-                        if (readCount == 0) {
-                            snprintf(response, MAX_RESPONSE_SIZE, "parse error: invalid string for arg %d", i + 1);
-                            return false;
-                        }
-                        command += readCount;
-                        break;
+                    if (isLineEnd && stream.length == 0) { return FEED_PENDING; } // empty line, such as the second half of "\r\n"
+                    if (!beginStreamCommand()) { return failUnknownStreamCommand(isLineEnd); }
+                    if (isLineEnd) { return finishStreamCommand(false, response); }
+                    stream.state = STREAM_SEPARATOR;
+                    return FEED_PENDING;
+                case STREAM_SEPARATOR:
+                    if (c == ' ') { return FEED_PENDING; }
+                    if (isLineEnd) { return finishStreamCommand(true, response); }
+                    if (stream.argTypes[stream.arg] == '\0') { return failStream(ERROR_TOO_MANY_ARGS, stream.arg, stream.offset, false); }
+                    beginStreamArgument();
+                    return stepArgument(c, false, response);
+                case STREAM_AFTER_ARGUMENT:
+                    if (c == ' ') {
+                        stream.state = STREAM_SEPARATOR;
+                        return FEED_PENDING;
                     }
-                    default:
-                        snprintf(response, MAX_RESPONSE_SIZE, "parse error: invalid argtype %c for arg %d", argTypes[i], i + 1);
-                        return false;
-                }
+                    if (isLineEnd) { return finishStreamCommand(false, response); }
+                    if (stream.argTypes[stream.arg] == '\0') { return failStream(ERROR_TOO_MANY_ARGS, stream.arg, stream.offset, false); }
+                    return failStream(ERROR_MISSING_WHITESPACE, stream.arg + 1, stream.offset, false);
+                default:
+                    return stepArgument(c, isLineEnd, response);
             }
+        }
 
-            // skip whitespace
-            while (*command == ' ') { command ++; }
+        void resetStream() {
+            stream.state = STREAM_NAME;
+            stream.length = 0;
+            stream.nameHash = COMMAND_NAME_HASH_SEED;
+        }
 
-            // ensure that we're at the end of the command
-            if (*command != '\0') {
-                snprintf(response, MAX_RESPONSE_SIZE, "parse error: too many args (expected %d)", strlen(argTypes));
-                return false;
+        // records the error at `offset` within the line and returns `FEED_FAILED`, ignoring the rest of the line unless it's already over
+        // `offset` is where `processCommand` would report the same error: the start of the offending argument, or of the command name if it's unknown
+        FeedStatus failStream(ErrorCode code, size_t argument, size_t offset, bool isLineEnd) {
+            error.code = code;
+            error.argument = argument;
+            error.offset = offset;
+            if (isLineEnd) { resetStream(); } else { stream.state = STREAM_DISCARD; }
+            return FEED_FAILED;
+        }
+        FeedStatus failUnknownStreamCommand(bool isLineEnd) {
+            errorName = stream.token;
+            errorNameLength = stream.length;
+            return failStream(ERROR_UNKNOWN_COMMAND, 0, 0, isLineEnd);
+        }
+        FeedStatus failArgument(bool isLineEnd) {
+            switch (stream.argTypes[stream.arg]) {
+                case 'd': return failStream(ERROR_INVALID_DOUBLE, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'u': return failStream(ERROR_INVALID_UINT64, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'i': return failStream(ERROR_INVALID_INT64, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'L': return failStream(ERROR_INVALID_UINT32, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'l': return failStream(ERROR_INVALID_INT32, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'H': return failStream(ERROR_INVALID_UINT16, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'h': return failStream(ERROR_INVALID_INT16, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'B': return failStream(ERROR_INVALID_UINT8, stream.arg + 1, stream.argStart, isLineEnd);
+                case 'b': return failStream(ERROR_INVALID_INT8, stream.arg + 1, stream.argStart, isLineEnd);
+                default: return failStream(ERROR_INVALID_STRING, stream.arg + 1, stream.argStart, isLineEnd);
             }
+        }
 
-            // set response to empty string
+        bool beginStreamCommand() {
+            const char *argTypes = findCommand(stream.token, stream.length, stream.nameHash, stream.argTypes, stream.handler);
+            if (argTypes == nullptr) { return false; }
+            if (argTypes != stream.argTypes) { strlcpy(stream.argTypes, argTypes, MAX_COMMAND_ARGS + 1); } // registered commands may move around if more are registered before the line ends
+            stream.arg = 0;
+            argBufferUsed = 0;
+            argBufferReserved = argBufferNeeded(stream.argTypes);
+            return true;
+        }
+
+        void beginStreamArgument() {
+            stream.length = 0;
+            stream.argStart = stream.offset;
+            switch (stream.argTypes[stream.arg]) {
+                case 'u': case 'i': case 'L': case 'l': case 'H': case 'h': case 'B': case 'b': stream.state = STREAM_INTEGER_SIGN; break;
+                case 'd': stream.state = STREAM_DOUBLE; break;
+                default: stream.state = STREAM_STRING_START; break;
+            }
+        }
+
+        // called at the end of the line; `afterSeparator` is whether the line ended with whitespace after the name or last argument
+        FeedStatus finishStreamCommand(bool afterSeparator, char *response) {
+            if (stream.argTypes[stream.arg] != '\0') {
+                if (!afterSeparator) { return failStream(ERROR_MISSING_WHITESPACE, stream.arg + 1, stream.offset, true); }
+                stream.argStart = stream.offset; // the missing argument would have started at the line end
+                return failArgument(true);
+            }
+            resetStream();
             response[0] = '\0';
+            if (stream.handler.invoke != nullptr) {
+                stream.handler.invoke(*this, stream.handler.callback, nullptr, response);
+            } else {
+                (*stream.handler.callback)(commandArgs, response);
+            }
+            return FEED_PROCESSED;
+        }
 
-            // invoke the command
-            (*callback)(commandArgs, response);
-            return true;
+        // called when the current argument ends with `c`, which is whitespace or the end of the line
+        FeedStatus finishStreamArgument(bool isLineEnd, char *response) {
+            stream.arg ++;
+            if (isLineEnd) { return finishStreamCommand(false, response); }
+            stream.state = STREAM_SEPARATOR;
+            return FEED_PENDING;
+        }
+
+        void finishStreamString() {
+            char *string = &argBuffer[argBufferUsed];
+            string[stream.length] = '\0';
+            if (stream.argTypes[stream.arg] == 's') {
+                commandArgs[stream.arg].asString = string;
+                argBufferReserved -= argBufferNeeded('s');
+            } else {
+                commandArgs[stream.arg].asStringView.ptr = string;
+                commandArgs[stream.arg].asStringView.len = stream.length;
+            }
+            argBufferUsed += stream.length + 1;
+        }
+
+        static constexpr bool isSignedIntegerArgType(char argType) { return argType == 'i' || argType == 'l' || argType == 'h' || argType == 'b'; }
+
+        // appends `digit` to the magnitude of the integer argument being read, which is kept in `asUInt64` until the argument ends
+        bool accumulateStreamDigit(Argument &argument, uint64_t digit) {
+            switch (stream.base) {
+                case 2: return strToIntAccumulate<uint64_t, 2>(&argument.asUInt64, digit);
+                case 8: return strToIntAccumulate<uint64_t, 8>(&argument.asUInt64, digit);
+                case 16: return strToIntAccumulate<uint64_t, 16>(&argument.asUInt64, digit);
+                default: return strToIntAccumulate<uint64_t, 10>(&argument.asUInt64, digit);
+            }
+        }
+
+        // replaces the magnitude in `asUInt64` with the signed value, stored as the argument's type, returning `false` instead if it's out of range for that type
+        bool finishStreamInteger(Argument &argument) {
+            uint64_t magnitude = argument.asUInt64;
+            switch (stream.argTypes[stream.arg]) {
+                case 'i': return strToIntApplySign<int64_t>(magnitude, stream.isNegative, &argument.asInt64, LONG_LONG_MIN, LONG_LONG_MAX);
+                case 'L': return strToIntApplySign<uint32_t>(magnitude, stream.isNegative, &argument.asUInt32, 0, 4294967295UL);
+                case 'l': return strToIntApplySign<int32_t>(magnitude, stream.isNegative, &argument.asInt32, -2147483647L - 1, 2147483647L);
+                case 'H': return strToIntApplySign<uint16_t>(magnitude, stream.isNegative, &argument.asUInt16, 0, 65535U);
+                case 'h': return strToIntApplySign<int16_t>(magnitude, stream.isNegative, &argument.asInt16, -32768, 32767);
+                case 'B': return strToIntApplySign<uint8_t>(magnitude, stream.isNegative, &argument.asUInt8, 0, 255);
+                case 'b': return strToIntApplySign<int8_t>(magnitude, stream.isNegative, &argument.asInt8, -128, 127);
+                default: return strToIntApplySign<uint64_t>(magnitude, stream.isNegative, &argument.asUInt64, 0, ULONG_LONG_MAX);
+            }
+        }
+
+        FeedStatus stepArgument(char c, bool isLineEnd, char *response) {
+            Argument &argument = commandArgs[stream.arg];
+            bool isEnd = c == ' ' || isLineEnd; // whether `c` ends an unquoted argument
+            switch (stream.state) {
+                case STREAM_INTEGER_SIGN:
+                    stream.isNegative = false;
+                    stream.base = 10;
+                    stream.hasDigits = false;
+                    argument.asUInt64 = 0;
+                    if (c == '-' || (c == '+' && isSignedIntegerArgType(stream.argTypes[stream.arg]))) { // like `strToInt`, this accepts "-0" for unsigned integers
+                        stream.isNegative = c == '-';
+                        stream.state = STREAM_INTEGER_START;
+                        return FEED_PENDING;
+                    }
+                    // fall through
+                case STREAM_INTEGER_START:
+                    if (c == '0') {
+                        stream.hasDigits = true;
+                        stream.state = STREAM_INTEGER_PREFIX;
+                        return FEED_PENDING;
+                    }
+                    stream.state = STREAM_INTEGER_DIGITS;
+                    return stepArgument(c, isLineEnd, response);
+                case STREAM_INTEGER_PREFIX:
+                    stream.state = STREAM_INTEGER_DIGITS;
+                    if (c == 'b' || c == 'o' || c == 'x') {
+                        stream.base = c == 'b' ? 2 : c == 'o' ? 8 : 16;
+                        stream.hasDigits = false;
+                        return FEED_PENDING;
+                    }
+                    return stepArgument(c, isLineEnd, response);
+                case STREAM_INTEGER_DIGITS: {
+                    if (isEnd && stream.hasDigits) { return finishStreamInteger(argument) ? finishStreamArgument(isLineEnd, response) : failArgument(isLineEnd); }
+                    int digit = strToIntDigit(c, stream.base);
+                    if (digit == -1 || !accumulateStreamDigit(argument, digit)) { return failArgument(isLineEnd); }
+                    stream.hasDigits = true;
+                    return FEED_PENDING;
+                }
+                case STREAM_DOUBLE: {
+                    if (!isEnd) {
+                        if (stream.length == STREAM_TOKEN_SIZE - 1) { return failArgument(false); }
+                        stream.token[stream.length ++] = c;
+                        return FEED_PENDING;
+                    }
+                    stream.token[stream.length] = '\0';
+                    size_t bytesRead = strToDouble(stream.token, &argument.asDouble);
+                    if (bytesRead == 0 || stream.token[bytesRead] != '\0') { return failArgument(isLineEnd); }
+                    return finishStreamArgument(isLineEnd, response);
+                }
+                case STREAM_STRING_START:
+                    if (stream.argTypes[stream.arg] == 's') { // string arguments always have space set aside for them
+                        if (MAX_ARG_BUFFER_SIZE == 0) { return failStream(ERROR_NO_ROOM_FOR_STRING, stream.arg + 1, stream.argStart, false); }
+                        stream.maxLength = MAX_COMMAND_ARG_SIZE;
+                    } else { // string views use whatever space isn't set aside for string arguments
+                        size_t available = MAX_ARG_BUFFER_SIZE - argBufferUsed - argBufferReserved;
+                        if (available == 0) { return failStream(ERROR_NO_ROOM_FOR_STRING, stream.arg + 1, stream.argStart, false); }
+                        stream.maxLength = available - 1;
+                    }
+                    stream.isQuoted = c == '"';
+                    stream.state = STREAM_STRING;
+                    if (stream.isQuoted) { return FEED_PENDING; }
+                    // fall through
+                case STREAM_STRING:
+                    if (stream.isQuoted ? c == '"' : isEnd) {
+                        finishStreamString();
+                        if (!stream.isQuoted) { return finishStreamArgument(isLineEnd, response); }
+                        stream.arg ++;
+                        stream.state = STREAM_AFTER_ARGUMENT;
+                        return FEED_PENDING;
+                    }
+                    if (stream.length == stream.maxLength) {
+                        if (stream.argTypes[stream.arg] != 's') { return failStream(ERROR_NO_ROOM_FOR_STRING, stream.arg + 1, stream.argStart, isLineEnd); } // string views have no length limit of their own
+                        if (stream.isQuoted) { return failArgument(isLineEnd); }
+                        finishStreamString(); // like `parseString`, end an unquoted string that's too long, so the next character is treated as coming after it
+                        stream.arg ++;
+                        stream.state = STREAM_AFTER_ARGUMENT;
+                        return stepStream(c, response);
+                    }
+                    if (isLineEnd) { return failArgument(true); } // unterminated quoted string
+                    if (c == '\\') {
+                        stream.state = STREAM_STRING_ESCAPE;
+                    } else {
+                        argBuffer[argBufferUsed + stream.length ++] = c;
+                    }
+                    return FEED_PENDING;
+                case STREAM_STRING_ESCAPE: {
+                    char decoded;
+                    switch (c) {
+                        case 'n': decoded = '\n'; break;
+                        case 'r': decoded = '\r'; break;
+                        case 't': decoded = '\t'; break;
+                        case '"': decoded = '"'; break;
+                        case '\\': decoded = '\\'; break;
+                        case 'x': // hex escape, of the form \xNN where NN is a byte in hex
+                            argBuffer[argBufferUsed + stream.length] = 0;
+                            stream.hexDigits = 0;
+                            stream.state = STREAM_STRING_HEX;
+                            return FEED_PENDING;
+                        default: // unknown escape sequence
+                            return failArgument(isLineEnd);
+                    }
+                    argBuffer[argBufferUsed + stream.length ++] = decoded;
+                    stream.state = STREAM_STRING;
+                    return FEED_PENDING;
+                }
+                case STREAM_STRING_HEX: {
+                    int digit = strToIntDigit(c, 16);
+                    if (digit == -1) { return failArgument(isLineEnd); }
+                    char &decoded = argBuffer[argBufferUsed + stream.length];
+                    decoded = decoded * 16 + digit;
+                    if (++ stream.hexDigits == 2) {
+                        stream.length ++;
+                        stream.state = STREAM_STRING;
+                    }
+                    return FEED_PENDING;
+                }
+                default:
+                    return FEED_PENDING;
+            }
         }
 };
 